@@ -2,866 +2,340 @@
 #include <scinstdlib.h>
 #include <stdlib.h>
 #include <string.h>
-
-void print_binary(int number, int width){
-	// printf("0b");
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "graphiteasm.h"
+
+void print_binary(FILE *output, int number, int width){
+	// fprintf(output, "0b");
 	for(int i = 1; i <= width; i++){
-		printf("%d", (number >> (width - i)) & 1);
+		fprintf(output, "%d", (number >> (width - i)) & 1);
 	}
 }
 
-struct LexerData{
-	char *file_contents;
-	int current_line;
-	int current_char_index;
-	struct Array *tokens;
-};
-
-enum TokenType {
-	TokenType_STAR,
-	TokenType_LBRACE,
-	TokenType_RBRACE,
-	TokenType_LSQBRACE,
-	TokenType_RSQBRACE,
-	TokenType_LPAREN,
-	TokenType_RPAREN,
-	TokenType_SEMICOLON,
-	TokenType_COLON,
-	TokenType_NONE,
-	TokenType_IDENTIFIER,
-	TokenType_STRING,
-	TokenType_NUMBER,
-	TokenType_EOF,
-	TokenType_ERROR
-};
-
-struct Token{
-	enum TokenType type;
-	union {
-		double number;
-		char *string;
-		struct {
-			int line;
-			char ch;
-			char *format;
-		} error_message;
-	} value; 
-};
-
-void handle_identifier(char **file_content_ptr, struct LexerData *lexer_data){
-	// this function is called when the current character is true when passed through isAlpha();
-	char ch;
-	struct Array* char_array = CreateArray();
-	while(isAlphaNumerical(ch = (*(*file_content_ptr)++))){
-		ADD_ELEMENT_TO_ARRAY(char_array, char, ch);
-	};
-
-	--(*file_content_ptr);
-
-	char *str = stringify_char_array(char_array);
-	struct Token new_identifier_token = {.type = TokenType_IDENTIFIER, .value = {.string = str}};
-	ADD_ELEMENT_TO_ARRAY(lexer_data->tokens, struct Token, new_identifier_token);
-	FreeArray(char_array);
-}
-
-void handle_number_literal(char **file_content_ptr, struct LexerData *lexer_data){
-	// this function is called when the current character is true when passed through isNumber();
-	char ch;
-	struct Array* number_char_array = CreateArray();
-	while(isNumber(ch = (*(*file_content_ptr)++))){
-		ADD_ELEMENT_TO_ARRAY(number_char_array, char, ch);
+void write_instructions(FILE *output, const uint32_t *instructions, long instruction_count){
+	for(long i = 0; i < instruction_count; i++){
+		print_binary(output, GRAPHITE_OPCODE(instructions[i]), 5);
+		fprintf(output, " ");
+		print_binary(output, GRAPHITE_FLAGS(instructions[i]), 3);
+		fprintf(output, " ");
+		print_binary(output, GRAPHITE_PARAMETER_1(instructions[i]), 8);
+		fprintf(output, " ");
+		print_binary(output, GRAPHITE_PARAMETER_2(instructions[i]), 8);
+		fprintf(output, "\n");
 	}
-
-	--(*file_content_ptr);
-
-	char *number_literal_as_string = stringify_char_array(number_char_array);
-	double number_literal = strtod(number_literal_as_string, NULL);
-	free(number_literal_as_string);
-	
-	struct Token new_number_literal_token = {.type = TokenType_NUMBER, .value = {.number = number_literal}};
-	ADD_ELEMENT_TO_ARRAY(lexer_data->tokens, struct Token, new_number_literal_token);
-	FreeArray(number_char_array);
 }
 
-struct Array *lexer(char *file_contents){
-#define HANDLE_SIMPLE_CHAR(token_type) \
-	{ \
-		struct Token new_token = {.type = token_type, .value = {.number = ch}}; \
-		ADD_ELEMENT_TO_ARRAY(tokens, struct Token, new_token); \
-		break; \
-	}
+// Maps the whole file read only, large listings are handed to the assembler without copying them
+const char *map_file(const char *path, size_t *length){
+	int file = open(path, O_RDONLY);
+	if(file == -1) return NULL;
 
-	struct LexerData *lexer_data = (struct LexerData*) malloc(sizeof(struct LexerData));
-	struct Array *tokens = CreateArray();
-	lexer_data->tokens = tokens;
-	lexer_data->file_contents = file_contents;
-	lexer_data->current_line = 0;
-	
-	char ch;
-	while((ch = *(file_contents++)) != 0){
-		switch(ch){
-			case '\n':
-				lexer_data->current_line++;
-			case '\t':
-			case '\r':
-			case ' ':
-				break;
-
-			case '*': HANDLE_SIMPLE_CHAR(TokenType_STAR);
-			case '{': HANDLE_SIMPLE_CHAR(TokenType_LBRACE);
-			case '}': HANDLE_SIMPLE_CHAR(TokenType_RBRACE);
-			case '[': HANDLE_SIMPLE_CHAR(TokenType_LSQBRACE);
-			case ']': HANDLE_SIMPLE_CHAR(TokenType_RSQBRACE);
-			case '(': HANDLE_SIMPLE_CHAR(TokenType_LPAREN);
-			case ')': HANDLE_SIMPLE_CHAR(TokenType_RPAREN);
-			case ';': HANDLE_SIMPLE_CHAR(TokenType_SEMICOLON);
-			case ':': HANDLE_SIMPLE_CHAR(TokenType_COLON);
-
-			default:
-				if(isAlpha(ch)){
-					--file_contents;
-					handle_identifier(&file_contents, lexer_data);	
-				}else if(isNumber(ch)){
-					--file_contents;
-					handle_number_literal(&file_contents, lexer_data);
-				}else{
-					// Was not able to match the character to a handler
-					char *error_message = (char*) malloc(40);
-					snprintf(error_message, 40, "Was not able to match character \"%c\"", ch);
-					struct Token error_token = {.type = TokenType_ERROR, .value = {.string = error_message}}; 
-					ADD_ELEMENT_TO_ARRAY(tokens, struct Token, error_token);
-				}
-		}
+	struct stat file_stat;
+	const char *contents = NULL;
+	if(fstat(file, &file_stat) == 0){
+		*length = file_stat.st_size;
+		// an empty file cannot be mapped
+		if(*length == 0) contents = "";
+		else if((contents = (const char*) mmap(NULL, *length, PROT_READ, MAP_PRIVATE, file, 0)) == MAP_FAILED) contents = NULL;
 	}
-	
-	ADD_ELEMENT_TO_ARRAY(tokens, struct Token, (struct Token) {.type = TokenType_EOF})
-	free(lexer_data); // TODO: Fix bug
-	return tokens;
-
-#undef HANDLE_SIMPLE_CHAR
+	close(file);
+	return contents;
 }
 
-void print_token(struct Token token){
-#define HANDLE_SIMPLE_CHAR(ch) \
-	case ch: \
-		printf("[%s]\n", #ch); \
-		break;
-	
-	switch(token.type){
-		HANDLE_SIMPLE_CHAR(TokenType_STAR);
-		HANDLE_SIMPLE_CHAR(TokenType_LBRACE);
-		HANDLE_SIMPLE_CHAR(TokenType_RBRACE);
-		HANDLE_SIMPLE_CHAR(TokenType_LSQBRACE);
-		HANDLE_SIMPLE_CHAR(TokenType_RSQBRACE);
-		HANDLE_SIMPLE_CHAR(TokenType_LPAREN);
-		HANDLE_SIMPLE_CHAR(TokenType_RPAREN);
-		HANDLE_SIMPLE_CHAR(TokenType_SEMICOLON);
-		HANDLE_SIMPLE_CHAR(TokenType_COLON);
-		HANDLE_SIMPLE_CHAR(TokenType_EOF);
-
-		case TokenType_IDENTIFIER:
-			printf("[TokenType_IDENTIFIER]: %s\n", token.value.string);
-			break;
-		case TokenType_NUMBER:
-			printf("[TokenType_NUMBER]: %f\n", token.value.number);
-			break;
-		case TokenType_ERROR:
-			printf("[TokenType_ERROR] %s\n", token.value.string);
-			break;
-		default:
-			printf("[print_token]: Was unable to match a token type %d\n", token.type);
-			break;
-	}
-
-#undef HANDLE_SIMPLE_CHAR
+void unmap_file(const char *contents, size_t length){
+	if(length > 0) munmap((void*) contents, length);
 }
 
-void print_tokens(struct Array* tokens){
-	printf("=== Printing tokens ===\n");
-	for(int i = 0; i < tokens->length; i++){
-		printf("[%4d] ", i);
-		print_token(GET_ELEMENT_FROM_ARRAY(tokens, struct Token, i));
+// Assembles one source file, writing the encoded instructions to output and diagnostics to errors
+int assemble_file(const char *input_path, const struct graphite_options *shared_options, FILE *output, FILE *errors){
+	size_t file_length;
+	const char *file_contents = map_file(input_path, &file_length);
+	if(file_contents == NULL){
+		fprintf(errors, "Was not able to read %s\n", input_path);
+		return 0;
 	}
-}
-
-enum CompilerResult {
-	CompilerResult_OK,
-	CompilerResult_PARSING_ERROR,
-	CompilerResult_CODE_GENERATION_ERROR,
-};
 
-struct ParsingData{
-	struct Array* tokens;
-	struct Hashmap* goto_labels;
-	int current_token_index;
-	int current_generated_line;
-	struct Token current_mnemonic;
-};
+	// the options are shared between batch jobs, the stats are not
+	struct graphite_stats stats;
+	struct graphite_options job_options = *shared_options;
+	job_options.stats = &stats;
+	const struct graphite_options *options = &job_options;
 
-#define GET_CURRENT_TOKEN(p) \
-	GET_ELEMENT_FROM_ARRAY(p->tokens, struct Token, p->current_token_index)
+	// start with room for the whole ROM and retry when the program turns out to be larger
+	size_t capacity = 1024;
+	uint32_t *instructions = (uint32_t*) malloc(sizeof(uint32_t) * capacity);
+	struct graphite_diag diag;
+	long instruction_count;
+	while((instruction_count = graphite_assemble_with_options(file_contents, file_length, instructions, capacity, options, &diag)) > (long) capacity){
+		capacity = instruction_count;
+		instructions = (uint32_t*) realloc(instructions, sizeof(uint32_t) * capacity);
+	}
 
-struct Token advance(struct ParsingData *parsing_data){
-	struct Token return_token = GET_ELEMENT_FROM_ARRAY(parsing_data->tokens, struct Token, parsing_data->current_token_index);
-	parsing_data->current_token_index++;
-	return return_token;
-}
+	if(instruction_count < 0) fprintf(errors, "%s:%d: %s\n", input_path, diag.line, diag.message);
+	else write_instructions(output, instructions, instruction_count);
 
-int match(struct ParsingData *parsing_data, enum TokenType token_type){
-	if(parsing_data == NULL) return 0;
-	struct Token current_token = GET_CURRENT_TOKEN(parsing_data);
-	
-	if(current_token.type == token_type){
-		parsing_data->current_token_index++;
-		return 1;
+	if(instruction_count > GRAPHITE_ROM_SIZE){
+		fprintf(errors == output ? stderr : errors, "%s: warning: program has %ld instructions, the ROM only holds %d\n",
+			input_path, instruction_count, GRAPHITE_ROM_SIZE);
 	}
 
-	return 0;
-}
+	if(instruction_count >= 0 && options->compact){
+		// the report must not end up in the middle of the instructions when both go to stdout
+		fprintf(errors == output ? stderr : errors, "%s: saved %zu instructions (%zu by tail merging, %zu by outlining)\n",
+			input_path, stats.tail_merge_saved + stats.outline_saved, stats.tail_merge_saved, stats.outline_saved);
+	}
 
-int is_finished_parsing_operand(struct Token token){
-	int return_value  = token.type == TokenType_SEMICOLON || token.type == TokenType_EOF;
-	return return_value;
+	free(instructions);
+	unmap_file(file_contents, file_length);
+	return instruction_count >= 0;
 }
 
-#define OPERAND_DEREFERENCE 1
-#define OPERAND_PORT 2
-#define OPERAND_IDENTIFIER 4
-
-struct Operand{
-	union {
-		double number;
-		char *string;
-	} value;
-	uint8_t flags;
+struct AssemblyJob{
+	const char *input_path;
+	int succeeded;
 };
 
-enum OperandPrecedence{
-	OperandPrecedence_NONE,
-	OperandPrecedence_PARENTHESIS,
-	OperandPrecedence_SQBRACE,
-	OperandPrecedence_PRIMARY
+// Each worker owns a deque of job indices. The owner takes jobs from the tail while idle workers steal from the head.
+struct WorkQueue{
+	pthread_mutex_t lock;
+	int *jobs;
+	int head;
+	int tail;
 };
 
-struct OperandParseTableEntry{
-	enum CompilerResult (*handler)(struct ParsingData*, struct Operand*);
-	enum OperandPrecedence precedence;	
+struct ThreadPool{
+	struct AssemblyJob *jobs;
+	const struct graphite_options *options;
+	struct WorkQueue *queues;
+	int worker_count;
+	pthread_mutex_t report_lock; // keeps the diagnostics of a job together on stderr
 };
 
-enum CompilerResult paren_operand(struct ParsingData* parsing_data, struct Operand* operand);
-enum CompilerResult brace_operand(struct ParsingData* parsing_data, struct Operand* operand);
-enum CompilerResult primary_operand(struct ParsingData* parsing_data, struct Operand* operand);
-static struct OperandParseTableEntry operand_parse_table[] = {
-	[TokenType_LPAREN]     = {paren_operand,   OperandPrecedence_PARENTHESIS},
-	[TokenType_LSQBRACE]   = {brace_operand,   OperandPrecedence_SQBRACE},
-	[TokenType_IDENTIFIER] = {primary_operand, OperandPrecedence_PRIMARY},
-	[TokenType_NUMBER]     = {primary_operand, OperandPrecedence_PRIMARY},
+struct Worker{
+	struct ThreadPool *pool;
+	int index;
+	pthread_t thread;
+	int is_started;
 };
 
-enum CompilerResult parse_operand(struct ParsingData *parsing_data, struct Operand* operand, enum OperandPrecedence precedence){
-	// take the current token and figure out what to do with it
-	struct Token current_token = GET_CURRENT_TOKEN(parsing_data);
-	struct OperandParseTableEntry handler = operand_parse_table[current_token.type];
-
-	if(handler.precedence < precedence || handler.handler == NULL){
-		printf("[parse_operand] Was not able to find a handler for token type %d\n", current_token.type);
-		return CompilerResult_PARSING_ERROR;
-	}
-
-	return handler.handler(parsing_data, operand);
+int take_job(struct WorkQueue *queue, int from_tail){
+	int job = -1;
+	pthread_mutex_lock(&queue->lock);
+	if(queue->head < queue->tail) job = from_tail ? queue->jobs[--queue->tail] : queue->jobs[queue->head++];
+	pthread_mutex_unlock(&queue->lock);
+	return job;
 }
 
-enum CompilerResult paren_operand(struct ParsingData* parsing_data, struct Operand* operand){
-	// consume left parenthesis
-	advance(parsing_data);
-	operand->flags |= OPERAND_PORT;
-	
-	// parse the inner value
-	enum CompilerResult inner_value_result = 
-		parse_operand(parsing_data, operand, operand_parse_table[TokenType_LPAREN].precedence + 1);
-	
-	if(inner_value_result != CompilerResult_OK) return inner_value_result;
+int next_job(struct ThreadPool *pool, int worker_index){
+	int job = take_job(&pool->queues[worker_index], 1);
 	
-	// this should be right parenthesis
-	if(!match(parsing_data, TokenType_RPAREN)){
-		printf("Expected R_PAREN after inner value of parenthesis expression");
-		return CompilerResult_PARSING_ERROR;
+	// jobs are never added once the pool is running, so every queue being empty means there is no work left
+	for(int i = 1; job == -1 && i < pool->worker_count; i++){
+		job = take_job(&pool->queues[(worker_index + i) % pool->worker_count], 0);
 	}
-	
-	return CompilerResult_OK;	
+	return job;
 }
 
-enum CompilerResult brace_operand(struct ParsingData* parsing_data, struct Operand* operand){
-	// consume left brace
-	advance(parsing_data);
-	operand->flags |= OPERAND_DEREFERENCE;
-	
-	// parse the inner value
-	enum CompilerResult inner_value_result = 
-		parse_operand(parsing_data, operand, operand_parse_table[TokenType_LBRACE].precedence + 1);
-	
-	if(inner_value_result != CompilerResult_OK) return inner_value_result;
+void run_job(struct ThreadPool *pool, struct AssemblyJob *job){
+	size_t output_path_length = strlen(job->input_path) + 5;
+	char *output_path = (char*) malloc(output_path_length);
+	snprintf(output_path, output_path_length, "%s.out", job->input_path);
 
-	// this should be right square brace
-	if(!match(parsing_data, TokenType_RSQBRACE)){
-		printf("Expected RSQ_BRACE after inner value of parenthesis expression");
-		return CompilerResult_PARSING_ERROR;
-	}
+	char *error_text = NULL;
+	size_t error_length = 0;
+	FILE *errors = open_memstream(&error_text, &error_length);
+	FILE *output = fopen(output_path, "w");
 
-	return CompilerResult_OK;	
-}
-
-enum CompilerResult primary_operand(struct ParsingData* parsing_data, struct Operand* operand){
-	struct Token current_token = advance(parsing_data);
-	switch(current_token.type){
-		case TokenType_IDENTIFIER:
-			operand->value.string = current_token.value.string;
-			operand->flags |= OPERAND_IDENTIFIER;
-			break;
-		case TokenType_NUMBER:
-			operand->value.number = current_token.value.number;
-		default: break; // unreachable
-	}
-	
-	return CompilerResult_OK;
-}
+	if(output == NULL){
+		fprintf(errors, "Was not able to open %s for writing\n", output_path);
+		job->succeeded = 0;
+	}else{
+		job->succeeded = assemble_file(job->input_path, pool->options, output, errors);
+		fclose(output);
 
-enum CompilerResult parse_operands(struct ParsingData *parsing_data, struct Array **returned_operands){
-	struct Array *operands = CreateArray();
-	
-	while(!is_finished_parsing_operand(GET_CURRENT_TOKEN(parsing_data))){
-		// parse a single operand here
-		struct Operand *operand = (struct Operand*) calloc(sizeof(struct Operand), 1);
-		enum CompilerResult parse_status = parse_operand(parsing_data, operand, OperandPrecedence_NONE);
-		if(parse_status != CompilerResult_OK) return parse_status;
-		ADD_ELEMENT_TO_ARRAY(operands, struct Operand, *operand);
+		// a partial or empty output left behind would look like the result of a successful run
+		if(!job->succeeded) remove(output_path);
 	}
-	
-	match(parsing_data, TokenType_SEMICOLON); // consumes semicolon at the end	
-	*returned_operands = operands;
-	return CompilerResult_OK;
-}
 
-void print_operands(struct Array* operands){
-	if(operands == NULL) return;
-
-	printf("=== Printing operands ===\n");
-	for(int i = 0; i < operands->length; i++){
-		struct Operand current_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, i);
-		
-		printf("[%4d] ", i);
-		
-		if(current_operand.flags & OPERAND_DEREFERENCE) printf("[DEREFERENCED] ");
-		if(current_operand.flags & OPERAND_PORT) printf("[PORT] ");
-		
-		if(current_operand.flags & OPERAND_IDENTIFIER) printf("%s", current_operand.value.string);
-		else printf("%f", current_operand.value.number);
-		
-		printf("\n");
+	fclose(errors);
+	if(error_length > 0){
+		pthread_mutex_lock(&pool->report_lock);
+		fprintf(stderr, "%s", error_text);
+		pthread_mutex_unlock(&pool->report_lock);
 	}
-}
-
-int is_operand_immediate(struct Operand operand){ return operand.flags == 0; }
-int is_operand_identifier(struct Operand operand){ return operand.flags == OPERAND_IDENTIFIER; }
-int is_operand_dereferenced_register(struct Operand operand){ return operand.flags == (OPERAND_IDENTIFIER | OPERAND_DEREFERENCE); }
-int is_operand_immediate_memory(struct Operand operand){ return operand.flags == OPERAND_DEREFERENCE; }
-int is_operand_immediate_port(struct Operand operand){ return operand.flags == OPERAND_DEREFERENCE; }
-int is_operand_dereferenced_port(struct Operand operand){ return operand.flags == (OPERAND_IDENTIFIER | OPERAND_DEREFERENCE | OPERAND_PORT); }
-
-#define REGISTER_IS_GPR 8
-#define REGISTER_READABLE_MAIN 4
-#define REGISTER_READABLE_SECONDARY 1
-#define REGISTER_WRITABLE 2
-struct Register{
-	const char *name;
-	int flags;
-};
-
-struct Register graphite_registers[] = {
-	[1] = (struct Register) { .name = "ax", .flags = 0b1111 },
-	[2] = (struct Register) { .name = "bx", .flags = 0b1111 },
-	[3] = (struct Register) { .name = "cx", .flags = 0b1111 },
-	[4] = (struct Register) { .name = "dx", .flags = 0b1111 },
-	[5] = (struct Register) { .name = "ex", .flags = 0b1111 },
-	[6] = (struct Register) { .name = "fx", .flags = 0b1111 },
-	[7] = (struct Register) { .name = "gx", .flags = 0b1111 },
-};
 
-int get_register_index(const char *const key){
-	for(int i = 1; i < sizeof(graphite_registers) / sizeof(struct Register); i++){
-		if(strcmp(graphite_registers[i].name, key) == 0){
-			return i;
-		}
-	}
-	
-	return -1;
+	free(error_text);
+	free(output_path);
 }
 
-int verify_register_flags(const char *const key, int flags){
-	int reg_index = get_register_index(key);
-	if(reg_index != -1){
-		if(graphite_registers[reg_index].flags & flags) return reg_index;
+void *worker_thread(void *argument){
+	struct Worker *worker = (struct Worker*) argument;
+	int job;
+	while((job = next_job(worker->pool, worker->index)) != -1){
+		run_job(worker->pool, &worker->pool->jobs[job]);
 	}
-	return -1;
+	return NULL;
 }
 
-enum CompilerResult print_opcode_parameters(int opcode_flags, int parameter_1, int parameter_2){
-	printf(" ");
-	print_binary(opcode_flags, 3);
-	printf(" ");
-	print_binary(parameter_1, 8);
-	printf(" ");
-	print_binary(parameter_2, 8);
-	printf("\n");
-	return CompilerResult_OK;
-}
+// Assembles every input on its own, writing the encoded instructions of input.asm into input.asm.out
+int assemble_batch(const char **input_paths, int input_count, int worker_count, const struct graphite_options *options){
+	if(worker_count > input_count) worker_count = input_count;
+	if(worker_count < 1) worker_count = 1;
 
-// Right shift can only process numbers sent to the top input bus
-// This includes all of the registers, and immediates, immediate memory dereference, immediate io dereference
-enum CompilerResult right_shift_handler(struct Array *operands, struct ParsingData *parsing_data){
-	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	
-	if(is_operand_identifier(operand)){
-		int register_index;
-		if((register_index = verify_register_flags(operand.value.string, REGISTER_READABLE_MAIN)) != -1){
-			return print_opcode_parameters(0b001, register_index, 0);
-		}else{
-			printf("Expected register identifier which is readable through main bus. Received %s\n", operand.value.string);
-			return CompilerResult_CODE_GENERATION_ERROR;
-		}
-	}else if(is_operand_immediate(operand)){
-		return print_opcode_parameters(0b101, operand.value.number, 0);	
-	}else if(is_operand_immediate_memory(operand)){
-		return print_opcode_parameters(0b100, 0, operand.value.number);
-	}else if(is_operand_immediate_port(operand)){
-		return print_opcode_parameters(0b011, 0, operand.value.number);
-	}else{
-		printf("Expected either register, immediate, immediate memory or port address.\n");
-		return CompilerResult_CODE_GENERATION_ERROR;
-	}
-}
-
-// Negate can process numbers which can be sent to the bottom input bus
-// This includes most registers and immediates
-
-enum CompilerResult negation_handler(struct Array *operands, struct ParsingData *parsing_data){
-	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-
-	if(is_operand_identifier(operand)){
-		int register_index;
-		if((register_index = verify_register_flags(operand.value.string, REGISTER_READABLE_SECONDARY)) != -1){
-			return print_opcode_parameters(0b001, 0, register_index);
-		}else{
-			printf("Expected register identifier which is readable through secondary bus. Received %s\n", operand.value.string);
-		}
-	}else if(is_operand_immediate(operand)){
-		return print_opcode_parameters(0b101, 0, operand.value.number);
-	}else{
-		printf("Expected either register or immediate.\n");
-	}
-	
-	return CompilerResult_CODE_GENERATION_ERROR;
-}
-
-enum CompilerResult arithmetic_handler(struct Array *operands, struct ParsingData *parsing_data){
-	if(operands->length < 2){
-		printf("Expected atleast two operands for arithmetic binary mnemonic\n");
-		return CompilerResult_CODE_GENERATION_ERROR;
+	struct ThreadPool pool = {
+		.jobs = (struct AssemblyJob*) malloc(sizeof(struct AssemblyJob) * input_count),
+		.options = options,
+		.queues = (struct WorkQueue*) malloc(sizeof(struct WorkQueue) * worker_count),
+		.worker_count = worker_count
 	};
-	
-	struct Operand first_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	struct Operand second_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1);
+	pthread_mutex_init(&pool.report_lock, NULL);
 
-	// reg - reg, reg - imm, gpr - imm io, gpr - imm mem, imm - imm
-	// Perform recursive descent for the operands
-	if(is_operand_immediate(first_operand) && is_operand_immediate(second_operand)){
-		return print_opcode_parameters(0b101, first_operand.value.number, second_operand.value.number);
+	for(int i = 0; i < input_count; i++){
+		pool.jobs[i] = (struct AssemblyJob) { .input_path = input_paths[i], .succeeded = 0 };
 	}
 
-	else if(is_operand_identifier(first_operand)){
-		int first_register_index;
-		if((first_register_index = get_register_index(first_operand.value.string)) != -1){
-			struct Register first_register = graphite_registers[first_register_index];
-			
-			if(first_register.flags & REGISTER_IS_GPR){
-				// check if the second operand is either an imm mem or imm io
-				int is_port;
-				if((is_port = is_operand_immediate_port(second_operand)) || is_operand_immediate_memory(second_operand)){
-					return print_opcode_parameters(is_port ? 0b011 : 0b100, first_register_index, second_operand.value.number);
-				}
-			}
-
-			if(is_operand_immediate(second_operand)){
-				return print_opcode_parameters(0b010, first_register_index, second_operand.value.number);
-			}else if(is_operand_identifier(second_operand)){
-				int second_register_index;
-				if((second_register_index = verify_register_flags(second_operand.value.string, REGISTER_READABLE_SECONDARY)) != -1){
-						return print_opcode_parameters(0b001, first_register_index, second_register_index);
-				}else{
-					printf("Expected second operand to be register label readable using secondary bus. Received %s\n", second_operand.value.string);
-				}
-			}else{
-				printf("Was not able to match a handler for the second operand in arithmetic handler\n");
-			}
-		}else{
-			printf("Expected identifier to contain register label. Received %s\n", first_operand.value.string);
-		}
-	}else{
-		printf("Was not able to perform recursive descent parsing on the operands\n");
+	// hand out contiguous slices, stealing evens things out when some files are much larger than others
+	for(int i = 0; i < worker_count; i++){
+		int first = (long) input_count * i / worker_count;
+		int last = (long) input_count * (i + 1) / worker_count;
+		pthread_mutex_init(&pool.queues[i].lock, NULL);
+		pool.queues[i].jobs = (int*) malloc(sizeof(int) * (last - first + 1));
+		pool.queues[i].head = 0;
+		pool.queues[i].tail = 0;
+		for(int job = last - 1; job >= first; job--) pool.queues[i].jobs[pool.queues[i].tail++] = job;
 	}
 
-	return CompilerResult_CODE_GENERATION_ERROR;
-}
-
-enum CompilerResult mov_handler(struct Array *operands, struct ParsingData *parsing_data){
-	// Move from register to register
-	// Move from register to memory using register dereference
-	// Move from register to memory using immediate address
-	// Move from register to IO port using immediate address
-	// Move to register from memory using register dereference
-	// Move to register from memory using immediate address
-	// Move to register from IO port using immediate address
-	
-	if(operands->length < 2){
-		printf("Expected atleast two operands for mov command\n");
-		return CompilerResult_CODE_GENERATION_ERROR;
+	struct Worker *workers = (struct Worker*) malloc(sizeof(struct Worker) * worker_count);
+	for(int i = 0; i < worker_count; i++){
+		workers[i] = (struct Worker) { .pool = &pool, .index = i };
+		workers[i].is_started = pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]) == 0;
 	}
 
-	struct Operand first_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	struct Operand second_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1);
-
-	if(is_operand_identifier(first_operand)){
-		int first_register_index;
-		if((first_register_index = verify_register_flags(first_operand.value.string, REGISTER_READABLE_MAIN)) != -1){
-			if(is_operand_identifier(second_operand)){
-				int second_register_index;
-				if((second_register_index = verify_register_flags(second_operand.value.string, REGISTER_WRITABLE)) != -1){
-					return print_opcode_parameters(0b001, first_register_index, second_register_index);
-				}else{
-					printf("Expected second operand to contain register label that is writable. Received %s\n", second_operand.value.string);
-				}
-			}
-
-			else if(is_operand_dereferenced_register(second_operand)){
-				int second_register_index;
-				if((second_register_index = verify_register_flags(second_operand.value.string, REGISTER_READABLE_SECONDARY)) != -1){
-					return print_opcode_parameters(0b010, first_register_index, second_register_index);
-				}else{
-					printf("Expected second operand to contain register label that is readable through secondary bus. Received %s\n", second_operand.value.string);
-				}
-			}
-			
-			else if(is_operand_immediate_memory(second_operand)){
-				return print_opcode_parameters(0b011, first_register_index, second_operand.value.number);
-			}
-			
-			else if(is_operand_immediate_port(second_operand)){
-				return print_opcode_parameters(0b100, first_register_index, second_operand.value.number);
-			}
-		}else{
-			printf("Expected first operand to contain register label readable through the main bus. Received %s\n", first_operand.value.string);
-		}
-	}else if(is_operand_identifier(second_operand)){
-		int second_register_index;
-		if((second_register_index = verify_register_flags(second_operand.value.string, REGISTER_WRITABLE)) != -1){
-			if(is_operand_dereferenced_register(first_operand)){
-				int first_register_index;
-				if((first_register_index = verify_register_flags(first_operand.value.string, REGISTER_READABLE_SECONDARY)) != -1){
-					return print_opcode_parameters(0b101, first_register_index, second_register_index);
-				}else{
-					printf("Expected first operand to contain register label that is readable through secondary bus. Received %s\n", first_operand.value.string);
-				}
-			}else if(is_operand_immediate_memory(first_operand)){
-				return print_opcode_parameters(0b110, first_operand.value.number, second_register_index);
-			}else if(is_operand_immediate_port(first_operand)){
-				return print_opcode_parameters(0b111, first_operand.value.number, second_register_index);
-			}else{
-				printf("Expected first operand to either be register dereference, immediate memory address, or immediate port address\n");
-			}
-		}
-	}else{
-		printf("Was not able to perform recursive descent on the operands\n");
+	// a worker whose thread cannot be started works on this one instead, its queue is still there to steal from
+	for(int i = 0; i < worker_count; i++){
+		if(!workers[i].is_started) worker_thread(&workers[i]);
 	}
 
-	return CompilerResult_CODE_GENERATION_ERROR;
-}
-
-enum CompilerResult loadimm_handler(struct Array *operands, struct ParsingData *parsing_data){
-	// Load immediate to register
-	// Load immediate to memory using register deref
-	// Load immediate to memory using immediate address
-	// Load immediate to port using immediate address
-	// Load immediate to port using register deref
-	if(operands->length < 2){
-		printf("Expected atleast two operands for loadimm mnemonic\n");
-		return CompilerResult_CODE_GENERATION_ERROR;
+	int failed_count = 0;
+	for(int i = 0; i < worker_count; i++){
+		if(workers[i].is_started) pthread_join(workers[i].thread, NULL);
 	}
+	for(int i = 0; i < input_count; i++) failed_count += !pool.jobs[i].succeeded;
+	printf("Assembled %d of %d files\n", input_count - failed_count, input_count);
 
-	struct Operand first_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	struct Operand second_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1);
-
-	if(is_operand_immediate(first_operand)){
-		if(second_operand.flags & OPERAND_IDENTIFIER){
-			int register_index;
-			if(second_operand.flags & OPERAND_DEREFERENCE){
-				if((register_index = verify_register_flags(second_operand.value.string, REGISTER_READABLE_SECONDARY)) != -1){
-					return print_opcode_parameters(second_operand.flags & OPERAND_PORT ? 0b101 : 0b010, first_operand.value.number, register_index);
-				}else{
-					printf("Expected second operand to be register label readable through secondary bus. Received %s\n", second_operand.value.string);
-				}
-			}else{
-				if((register_index = verify_register_flags(second_operand.value.string, REGISTER_WRITABLE)) != -1){
-					return print_opcode_parameters(0b001, first_operand.value.number, register_index);
-				}else{
-					printf("Expected second operand to be register label that is writable. Received %s\n", second_operand.value.string);
-				}
-			}
-		}else if(second_operand.flags & OPERAND_DEREFERENCE || second_operand.flags & OPERAND_PORT){
-			return print_opcode_parameters(second_operand.flags & OPERAND_PORT ? 0b100 : 0b011, first_operand.value.number, second_operand.value.number);
-		}else{
-			printf("Expected second parameter to either be register or dereferenced immediate\n");
-		}
-	}else{
-		printf("Expected first operand to be an immediate.\n");
+	for(int i = 0; i < worker_count; i++){
+		pthread_mutex_destroy(&pool.queues[i].lock);
+		free(pool.queues[i].jobs);
 	}
-
-	return CompilerResult_CODE_GENERATION_ERROR;
+	pthread_mutex_destroy(&pool.report_lock);
+	free(workers);
+	free(pool.queues);
+	free(pool.jobs);
+	return failed_count == 0 ? 0 : -1;
 }
 
-enum CompilerResult push_handler(struct Array *operands, struct ParsingData *parsing_data){
-	// Push register into stack
-	// Push immediate into stack
-	if(operands->length < 1){
-		printf("Expected atleast one operand for push mnemonic.\n");
-		return CompilerResult_CODE_GENERATION_ERROR;
-	}
+// Reads one input path per line, the paths point into the manifest contents which are kept for the rest of the run
+int read_manifest(const char *manifest_path, struct Array *input_paths){
+	char *manifest = readFile(manifest_path);
+	if(manifest == NULL) return 0;
 
-	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	if(is_operand_identifier(operand)){
-		int register_index;
-		if((register_index = verify_register_flags(operand.value.string, REGISTER_READABLE_MAIN)) != -1){
-			print_opcode_parameters(0b001, register_index, 0);
-		}else{
-			printf("Expected parameter to be register label that is readable through the main bus. Received %s\n", operand.value.string);
-		}
-	}else if(is_operand_immediate(operand)){
-		print_opcode_parameters(0b010, operand.value.number, 0);
-	}else{
-		printf("Expected push parameter to be either register or immediate\n");
+	for(char *line = strtok(manifest, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")){
+		if(*line == 0) continue;
+		ADD_ELEMENT_TO_ARRAY(input_paths, const char*, line);
 	}
-
-	return CompilerResult_CODE_GENERATION_ERROR;
+	return 1;
 }
 
-enum CompilerResult pop_handler(struct Array *operands, struct ParsingData *parsing_data){
-	if(operands->length < 1){
-		printf("Expected atleast one operand for pop mnemonic.\n");
-		return CompilerResult_CODE_GENERATION_ERROR;
-	}
+// Reads one "from to count" edge per line, as recorded by running the image assembled without a profile
+int read_profile(const char *profile_path, struct Array *edges){
+	char *profile = readFile(profile_path);
+	if(profile == NULL) return 0;
 
-	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	if(is_operand_identifier(operand)){
-		int register_index;
-		if((register_index = verify_register_flags(operand.value.string, REGISTER_IS_GPR)) != -1){
-			print_opcode_parameters(0b001, register_index, 0);	
-		}else{
-			printf("Expected parameter to be general purpose register label\n");
-		}
-	}else{
-		printf("Expected operand to be identifie.\n");
-	}
-	return CompilerResult_CODE_GENERATION_ERROR;
-}
-
-char *reset_targets[] = { NULL, "gpr", "mem", "stack", "io", "acc", "flag" };
-enum CompilerResult reset_handler(struct Array *operands, struct ParsingData *parsing_data){
-	if(operands->length < 1){
-		printf("Expected atleast 1 operand for reset mnemonic.\n");
-		return CompilerResult_CODE_GENERATION_ERROR;
-	}
-	
-	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	if(is_operand_identifier(operand)){
-		// determine the index of the target
-		for(int i = 1; i < (sizeof(reset_targets) / sizeof(char*)); i++){
-			if(strcmp(reset_targets[i], operand.value.string) == 0){
-				return print_opcode_parameters(i, 0, 0);
-			}
-		}
+	for(char *line = strtok(profile, "\r\n"); line != NULL; line = strtok(NULL, "\r\n")){
+		unsigned int from, to;
+		unsigned long long count;
+		if(sscanf(line, "%u %u %llu", &from, &to, &count) != 3) continue;
 
-		printf("Did not find reset target with the label of %s\n", operand.value.string);
-	}else{
-		printf("Expected operand to for reset mnemonic be identifier\n");
+		struct graphite_profile_edge edge = { .from = from, .to = to, .count = count };
+		ADD_ELEMENT_TO_ARRAY(edges, struct graphite_profile_edge, edge);
 	}
-	return CompilerResult_CODE_GENERATION_ERROR;
-}
 
-enum CompilerResult nop_handler(struct Array *operands, struct ParsingData *parsing_data){
-	return print_opcode_parameters(0, 0, 0);
+	free(profile);
+	return 1;
 }
 
-enum CompilerResult jmp_handler(struct Array *operands, struct ParsingData *parsing_data){
-	// Jump immediate
-	// Jump from register
-	// Jump from immediate memory address
-	// Jump from dereferenced memory address
-	// Jump from immediate IO address
-	// Jump from dereferenced IO address
-	
-	int is_conditional = strcmp(parsing_data->current_mnemonic.value.string, "cjmp") == 0;
-	if(operands->length < (is_conditional ? 2 : 1)){
-		printf("Expected atleast %d operands for %s mnemonic.\n", is_conditional ? 2 : 1, parsing_data->current_mnemonic.value.string);
-		return CompilerResult_CODE_GENERATION_ERROR;
+int main(int argc, char **argv){
+	if(argc < 2){
+		printf("Expected atleast one argument\n");
+		return -1;
 	}
 
-	struct Operand target = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
-	int flags = is_conditional ? (GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1)).value.number : 0;
-	
-	if(target.flags & OPERAND_IDENTIFIER){
-		int register_index;
-		if((register_index = get_register_index(target.value.string)) != -1){
-			if(target.flags & OPERAND_DEREFERENCE){
-				if(verify_register_flags(target.value.string, REGISTER_READABLE_SECONDARY)){
-					return print_opcode_parameters(target.flags & OPERAND_PORT ? 0b110 : 0b100, register_index, flags);
-				}else{
-					printf("Expected register to be readable through secondary bus\n");
-				}
-			}else{
-				if(verify_register_flags(target.value.string, REGISTER_READABLE_MAIN)){
-					return print_opcode_parameters(0b010, register_index, flags);
-				}else{
-					printf("Expected register to be readable through main bus\n");
-				}	
+	// assembler [--profile file] [--remove-dead-alu] [--compact] [--threads threads] input
+	// assembler --batch [-j workers] [--manifest file] [--remove-dead-alu] [--compact] [--threads threads] inputs...
+	int is_batch = 0, has_profile = 0, remove_dead_alu = 0, compact = 0, thread_count = 1;
+	int worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+	struct Array *input_paths = CreateArray();
+	struct Array *profile_edges = CreateArray();
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--batch") == 0){
+			is_batch = 1;
+		}else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+			worker_count = atoi(argv[++i]);
+		}else if(strcmp(argv[i], "--manifest") == 0 && i + 1 < argc){
+			if(!read_manifest(argv[++i], input_paths)){
+				printf("Was not able to read manifest %s\n", argv[i]);
+				return -1;
 			}
-		}else{
-			// check if it's a goto label
-			if(isKeyInHashmap(parsing_data->goto_labels, target.value.string) == 1){
-				int jump_point = GET_ELEMENT_FROM_HASHMAP(parsing_data->goto_labels, target.value.string, int);
-				print_opcode_parameters(0b001, jump_point, flags);
-			}else{
-				printf("Was not able to match identifier in goto parameter to either register or goto label");
+		}else if(strcmp(argv[i], "--profile") == 0 && i + 1 < argc){
+			has_profile = 1;
+			if(!read_profile(argv[++i], profile_edges)){
+				printf("Was not able to read profile %s\n", argv[i]);
+				return -1;
 			}
-		}
-	}else{
-		if(target.flags & OPERAND_DEREFERENCE){
-			return print_opcode_parameters(target.flags & OPERAND_PORT ? 0b101 : 0b011, target.value.number, flags);
+		}else if(strcmp(argv[i], "--remove-dead-alu") == 0){
+			remove_dead_alu = 1;
+		}else if(strcmp(argv[i], "--compact") == 0){
+			compact = 1;
+		}else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc){
+			thread_count = atoi(argv[++i]);
 		}else{
-			return print_opcode_parameters(0b001, target.value.number, flags);
+			ADD_ELEMENT_TO_ARRAY(input_paths, const char*, argv[i]);
 		}
 	}
-	
-	return CompilerResult_CODE_GENERATION_ERROR;
-}
-
-struct Mnemonic{
-	const char *const name;
-	enum CompilerResult (*operand_handler)(struct Array *operands, struct ParsingData *parsing_data);
-};
-
-struct Mnemonic graphite_mnemonics[] = {
-	[0b00000] = { .name = "nop",      .operand_handler = &nop_handler  },
-	[0b00001] = { .name = "add",      .operand_handler = &arithmetic_handler  },
-	[0b00010] = { .name = "sub",      .operand_handler = &arithmetic_handler  },
-	[0b00011] = { .name = "xor",      .operand_handler = &arithmetic_handler  },
-	[0b00100] = { .name = "and",      .operand_handler = &arithmetic_handler  },
-	[0b00101] = { .name = "or",       .operand_handler = &arithmetic_handler  },
-	[0b00110] = { .name = "xnor",     .operand_handler = &arithmetic_handler  },
-	[0b00111] = { .name = "nand",     .operand_handler = &arithmetic_handler  },
-	[0b01000] = { .name = "nor",      .operand_handler = &arithmetic_handler  },
-	[0b01001] = { .name = "rs",       .operand_handler = &right_shift_handler },
-	[0b01010] = { .name = "neg",      .operand_handler = &negation_handler    },
-	[0b10001] = { .name = "mov",      .operand_handler = &mov_handler         },
-	[0b10010] = { .name = "loadimm",  .operand_handler = &loadimm_handler     },
-	[0b10011] = { .name = "push",     .operand_handler = &push_handler        },
-	[0b10100] = { .name = "pop",      .operand_handler = &pop_handler         },
-	[0b10101] = { .name = "reset",    .operand_handler = &reset_handler       },
-	[0b10110] = { .name = "resetall", .operand_handler = &nop_handler         },
-	[0b11101] = { .name = "jmp",      .operand_handler = &jmp_handler         },
-	[0b11110] = { .name = "cjmp",     .operand_handler = &jmp_handler         },
-	[0b11111] = { .name = "hlt",      .operand_handler = &nop_handler         },
-};
 
-int find_index_of_mnemonic(const char *const key){
-	for(int i = 0; i < sizeof(graphite_mnemonics) / sizeof(struct Mnemonic); i++){
-		if(graphite_mnemonics[i].name == NULL) continue;
-		if(strcmp(graphite_mnemonics[i].name, key) == 0) return i;
-	}
-	return -1;
-}
-
-enum CompilerResult parse_token(struct ParsingData* parsing_data, struct Token first_token){
-	switch(first_token.type){
-		case TokenType_IDENTIFIER:{
-			int identifier_handler_index = find_index_of_mnemonic(first_token.value.string);
-			struct Token mnemonic_token = advance(parsing_data);
-			parsing_data->current_mnemonic = mnemonic_token;
-			
-			if(identifier_handler_index != -1){
-				struct Mnemonic identifier_handler = graphite_mnemonics[identifier_handler_index];
-				struct Array *operands;
-				enum CompilerResult operand_parsing_status = parse_operands(parsing_data, &operands);
-				if(operand_parsing_status != CompilerResult_OK) return operand_parsing_status;
-				// print_operands(operands);
-				
-				print_binary(identifier_handler_index, 5);
-				enum CompilerResult parsing_status = identifier_handler.operand_handler(operands, parsing_data);
-				return parsing_status;
-			}
-
-			else{
-				if(!match(parsing_data, TokenType_COLON)){
-					printf("Identifier %s is not a mnemonic nor is it a goto label. Expected TokenType_COLON, Received: %d\n", first_token.value.string, (GET_CURRENT_TOKEN(parsing_data)).type);
-					return CompilerResult_PARSING_ERROR;
-				}
-
-				// add goto label here
-				// printf("Adding goto label %s pointing to index %d\n", first_token.value.string, parsing_data->current_generated_line);
-				ADD_ELEMENT_TO_HASHMAP(parsing_data->goto_labels, first_token.value.string, int, parsing_data->current_generated_line);
-				return CompilerResult_OK;
-			}
-			
-			break;
-		}
-		
-		default:
-			printf("Was not able to find a handler for token type: %d\n", first_token.type);
-			return CompilerResult_PARSING_ERROR;
+	if(input_paths->length == 0){
+		printf("Expected atleast one input\n");
+		return -1;
 	}
-}
 
-enum CompilerResult parse(struct Array* tokens){
-	struct ParsingData* parsing_data = (struct ParsingData*) malloc(sizeof(struct ParsingData));
-	parsing_data->tokens = tokens;
-	parsing_data->current_generated_line = 0;
-	parsing_data->current_token_index = 0;
-	parsing_data->goto_labels = CreateHashmap();
-	
-	struct Token current_token;
-	while((current_token = GET_CURRENT_TOKEN(parsing_data)).type != TokenType_EOF){
-		enum CompilerResult result = parse_token(parsing_data, current_token);
-		if(result != CompilerResult_OK) return result;
-		
-		parsing_data->current_generated_line++;
-		// break; // remove this later, right now it only generates code for one line
+	// a profile describes the image of one program, applying it to others would reorder them at random
+	if(is_batch && has_profile){
+		printf("--profile cannot be used with --batch\n");
+		return -1;
 	}
-	
-	return CompilerResult_OK;
-}
-
-int main(int argc, char **argv){
-	if(argc < 2){
-		printf("Expected atleast one argument\n");
+	if(!is_batch && input_paths->length > 1){
+		printf("Expected one input, use --batch to assemble several\n");
 		return -1;
 	}
-	
-	char *file_contents = readFile(argv[1]);
-	struct Array *tokens = lexer(file_contents);
-	free(file_contents);
-	// print_tokens(tokens);
 
-	struct Array *before_tampered = tokens;
-	parse(tokens);
+	struct graphite_profile_edge *profile = (struct graphite_profile_edge*) malloc(sizeof(struct graphite_profile_edge) * (profile_edges->length + 1));
+	for(int i = 0; i < profile_edges->length; i++) profile[i] = GET_ELEMENT_FROM_ARRAY(profile_edges, struct graphite_profile_edge, i);
+	struct graphite_options options = { .profile = profile, .profile_length = profile_edges->length, .remove_dead_alu = remove_dead_alu, .compact = compact, .stats = NULL, .thread_count = thread_count };
+
+	const char **paths = (const char**) malloc(sizeof(const char*) * input_paths->length);
+	for(int i = 0; i < input_paths->length; i++) paths[i] = GET_ELEMENT_FROM_ARRAY(input_paths, const char*, i);
+
+	int status;
+	if(is_batch) status = assemble_batch(paths, input_paths->length, worker_count, &options);
+	else status = assemble_file(paths[0], &options, stdout, stdout) ? 0 : -1;
 
-	FreeArray(tokens);
-	return 0;
+	free(profile);
+	free(paths);
+	FreeArray(profile_edges);
+	FreeArray(input_paths);
+	return status;
 }
@@ -1,39 +1,107 @@
+import glob
+import os
+import re
 import sys
 import mcschematic
 
+TORCH = "minecraft:redstone_wall_torch[facing=east]"
+AIR = "minecraft:air"
+BITS_PER_LINE = 24
+LINES_PER_LAYER = 256
+LAYERS = 4
+
+def read_image(input_filename):
+    if input_filename.endswith(".asm"):
+        # assemble in process instead of going through the assembler's text output
+        import graphiteasm
+        image = [f"{instruction:024b}" for instruction in graphiteasm.assemble(open(input_filename, "r").read())]
+    else:
+        image = [line.replace(" ", "") for line in open(input_filename, "r").read().splitlines()]
+    for line in image:
+        if len(line) > BITS_PER_LINE:
+            raise Exception("Expected to end at 24th bit of line")
+    if len(image) > LINES_PER_LAYER * LAYERS:
+        raise Exception("Exceeded number of instructions encodable")
+    return image
+
+def get_coordinates(line_index, torch_index):
+    current_layer, current_line_in_layer = divmod(line_index, LINES_PER_LAYER)
+    return (
+        current_line_in_layer * 2 + 1,       # instruction index in layer
+        -1 * (current_layer * 5 + 1),        # current layer
+        -1 * (torch_index * 2 + 1)           # the bit that is being processed
+    )
+
+def sidecar_filename(output_filename):
+    # the image the last schematic was generated from, used as the base of the next delta
+    return output_filename + ".image"
+
+def save_sidecar(image, output_filename):
+    open(sidecar_filename(output_filename), "w").write("\n".join(image) + "\n")
+
 def generate(input_filename, output_filename):
-    line_split  = open(input_filename, "r").read().splitlines()
+    image = read_image(input_filename)
     schem = mcschematic.MCSchematic()
-    current_line_in_layer = 0
-    current_layer = 0
-
-    for line in line_split:
-        current_torch_in_line = 0
-        for c in list(line.replace(" ", "")):
-            if current_torch_in_line > 23:
-                raise Exception("Expected to end at 24th bit of line")
-            
+
+    for line_index, line in enumerate(image):
+        for torch_index, c in enumerate(line):
             if c == '1':
-                coordinates = (
-                    current_line_in_layer * 2 + 1,       # instruction index in layer 
-                    -1 * (current_layer * 5 + 1),        # current layer
-                    -1 * (current_torch_in_line * 2 + 1) # the bit that is being processed
-                )
+                coordinates = get_coordinates(line_index, torch_index)
                 print(f"Adding redstone torch to {coordinates[0]}, ~{coordinates[1]}, ~{coordinates[2]}")
-                schem.setBlock(coordinates, "minecraft:redstone_wall_torch[facing=east]")
-            current_torch_in_line += 1
-        
-        # move to the next instruction
-        current_line_in_layer += 1
-        if current_line_in_layer > 255:
-            current_line_in_layer = 0
-            current_layer += 1
-            if current_layer > 3:
-                raise Exception("Exceeded number of instructions encodable")
-    
+                schem.setBlock(coordinates, TORCH)
+
     schem.save(".", output_filename, mcschematic.Version.JE_1_17)
+    save_sidecar(image, output_filename)
+
+def get_changed_regions(previous_image, image):
+    # groups changed lines into runs of consecutive lines that stay within one layer
+    regions = []
+    for line_index in range(max(len(previous_image), len(image))):
+        previous_line = previous_image[line_index] if line_index < len(previous_image) else ""
+        line = image[line_index] if line_index < len(image) else ""
+        if previous_line.ljust(BITS_PER_LINE, "0") == line.ljust(BITS_PER_LINE, "0"):
+            continue
+
+        if regions and regions[-1][1] == line_index and line_index % LINES_PER_LAYER != 0:
+            regions[-1][1] = line_index + 1
+        else:
+            regions.append([line_index, line_index + 1])
+    return regions
+
+def generate_delta(input_filename, output_filename):
+    if not os.path.exists(sidecar_filename(output_filename)):
+        print(f"No previous image found at {sidecar_filename(output_filename)}, generating the full schematic")
+        generate(input_filename, output_filename)
+        return
+
+    previous_image = read_image(sidecar_filename(output_filename))
+    image = read_image(input_filename)
+    regions = get_changed_regions(previous_image, image)
+
+    # regions left over from an earlier delta would look current, so only this run's regions are kept
+    for stale_filename in glob.glob(glob.escape(output_filename) + "_delta_*.schem"):
+        if re.fullmatch(re.escape(output_filename) + r"_delta_[0-9]+\.schem", stale_filename):
+            os.remove(stale_filename)
+
+    for region_index, (start, end) in enumerate(regions):
+        # every bit of a changed line is written so the region does not depend on what is in the world
+        schem = mcschematic.MCSchematic()
+        for line_index in range(start, end):
+            line = (image[line_index] if line_index < len(image) else "").ljust(BITS_PER_LINE, "0")
+            for torch_index, c in enumerate(line):
+                schem.setBlock(get_coordinates(line_index, torch_index), TORCH if c == '1' else AIR)
+
+        region_filename = f"{output_filename}_delta_{region_index}"
+        print(f"Writing lines {start} to {end - 1} to {region_filename}")
+        schem.save(".", region_filename, mcschematic.Version.JE_1_17)
+
+    print(f"{len(regions)} region(s) changed")
+    save_sidecar(image, output_filename)
 
-if len(sys.argv) < 3:
+arguments = [argument for argument in sys.argv[1:] if argument != "--delta"]
+if len(arguments) < 2:
     print("Expected atleast two arguments")
+elif "--delta" in sys.argv[1:]:
+    generate_delta(arguments[0], arguments[1])
 else:
-    generate(sys.argv[1], sys.argv[2])
+    generate(arguments[0], arguments[1])
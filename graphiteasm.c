@@ -0,0 +1,2415 @@
+#include <stdio.h>
+#include <scinstdlib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include "graphiteasm.h"
+
+// The library never prints and keeps no mutable globals, every assembly owns all of its state
+
+struct LexerData{
+	const char *file_contents;
+	const char *file_end;
+	int current_line;
+	int current_char_index;
+	struct Array *tokens;
+	struct SymbolTable *symbols;
+};
+
+enum TokenType {
+	TokenType_STAR,
+	TokenType_LBRACE,
+	TokenType_RBRACE,
+	TokenType_LSQBRACE,
+	TokenType_RSQBRACE,
+	TokenType_LPAREN,
+	TokenType_RPAREN,
+	TokenType_SEMICOLON,
+	TokenType_COLON,
+	TokenType_NONE,
+	TokenType_IDENTIFIER,
+	TokenType_STRING,
+	TokenType_NUMBER,
+	TokenType_EOF,
+	TokenType_ERROR
+};
+
+struct Token{
+	enum TokenType type;
+	int line;
+	union {
+		double number;
+		int symbol;
+		char *string;
+		struct {
+			int line;
+			char ch;
+			char *format;
+		} error_message;
+	} value; 
+};
+
+enum SymbolKind {
+	SymbolKind_LABEL,
+	SymbolKind_MNEMONIC,
+	SymbolKind_REGISTER,
+	SymbolKind_RESET_TARGET
+};
+
+// Symbol ids carry their kind in the upper bits and a dense index in the lower bits.
+// Mnemonics, registers and reset targets use their index in the corresponding table,
+// labels are numbered in the order they are first seen.
+#define SYMBOL_INDEX_BITS 24
+#define SYMBOL_ID(kind, index) (((kind) << SYMBOL_INDEX_BITS) | (index))
+#define SYMBOL_KIND(id) ((enum SymbolKind) ((id) >> SYMBOL_INDEX_BITS))
+#define SYMBOL_INDEX(id) ((id) & ((1 << SYMBOL_INDEX_BITS) - 1))
+
+struct Symbol{
+	char *name;
+	int length;
+	uint32_t hash;
+	int id;
+};
+
+struct SymbolTable{
+	struct Symbol *symbols;
+	int symbol_count;
+	int symbol_capacity;
+	int *slots; // open addressing with linear probing, -1 marks an empty slot
+	int slot_capacity; // always a power of two
+	int label_count;
+};
+
+static uint32_t hash_symbol_name(const char *name, int length){
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for(int i = 0; i < length; i++){
+		hash ^= (unsigned char) name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static int find_symbol_slot(struct SymbolTable *table, const char *name, int length, uint32_t hash){
+	int mask = table->slot_capacity - 1;
+	int slot = hash & mask;
+	while(table->slots[slot] != -1){
+		struct Symbol *symbol = &table->symbols[table->slots[slot]];
+		if(symbol->hash == hash && symbol->length == length && memcmp(symbol->name, name, length) == 0) break;
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+static void grow_symbol_slots(struct SymbolTable *table){
+	free(table->slots);
+	table->slot_capacity *= 2;
+	table->slots = (int*) malloc(sizeof(int) * table->slot_capacity);
+	memset(table->slots, -1, sizeof(int) * table->slot_capacity);
+
+	for(int i = 0; i < table->symbol_count; i++){
+		struct Symbol *symbol = &table->symbols[i];
+		table->slots[find_symbol_slot(table, symbol->name, symbol->length, symbol->hash)] = i;
+	}
+}
+
+static int define_symbol(struct SymbolTable *table, const char *name, int length, int id){
+	if((table->symbol_count + 1) * 2 > table->slot_capacity) grow_symbol_slots(table);
+	if(table->symbol_count == table->symbol_capacity){
+		table->symbol_capacity *= 2;
+		table->symbols = (struct Symbol*) realloc(table->symbols, sizeof(struct Symbol) * table->symbol_capacity);
+	}
+
+	uint32_t hash = hash_symbol_name(name, length);
+	struct Symbol *symbol = &table->symbols[table->symbol_count];
+	symbol->name = (char*) malloc(length + 1);
+	memcpy(symbol->name, name, length);
+	symbol->name[length] = 0;
+	symbol->length = length;
+	symbol->hash = hash;
+	symbol->id = id;
+
+	table->slots[find_symbol_slot(table, name, length, hash)] = table->symbol_count++;
+	return id;
+}
+
+// Returns the id of the identifier, or -1 when it was never interned
+static int find_symbol(struct SymbolTable *table, const char *name, int length){
+	int index = table->slots[find_symbol_slot(table, name, length, hash_symbol_name(name, length))];
+	return index == -1 ? -1 : table->symbols[index].id;
+}
+
+// Returns the id of the identifier, identifiers which were not predefined become labels
+static int intern_symbol(struct SymbolTable *table, const char *name, int length){
+	int id = find_symbol(table, name, length);
+	if(id != -1) return id;
+
+	return define_symbol(table, name, length, SYMBOL_ID(SymbolKind_LABEL, table->label_count++));
+}
+
+static const char *get_symbol_name(struct SymbolTable *table, int id){
+	// only used for diagnostics, so a linear search is fine
+	for(int i = 0; i < table->symbol_count; i++){
+		if(table->symbols[i].id == id) return table->symbols[i].name;
+	}
+	return "<unknown symbol>";
+}
+
+static void free_symbol_table(struct SymbolTable *table){
+	for(int i = 0; i < table->symbol_count; i++) free(table->symbols[i].name);
+	free(table->symbols);
+	free(table->slots);
+	free(table);
+}
+
+static void handle_identifier(const char **file_content_ptr, struct LexerData *lexer_data){
+	// this function is called when the current character is true when passed through isAlpha();
+	// the identifier is interned straight from the source so no string is allocated per token
+	const char *start = *file_content_ptr;
+	while(*file_content_ptr < lexer_data->file_end && isAlphaNumerical(**file_content_ptr)) (*file_content_ptr)++;
+
+	int symbol = intern_symbol(lexer_data->symbols, start, *file_content_ptr - start);
+	struct Token new_identifier_token = {.type = TokenType_IDENTIFIER, .line = lexer_data->current_line, .value = {.symbol = symbol}};
+	ADD_ELEMENT_TO_ARRAY(lexer_data->tokens, struct Token, new_identifier_token);
+}
+
+static void handle_number_literal(const char **file_content_ptr, struct LexerData *lexer_data){
+	// this function is called when the current character is true when passed through isNumber();
+	char ch;
+	struct Array* number_char_array = CreateArray();
+	while(*file_content_ptr < lexer_data->file_end && isNumber(ch = **file_content_ptr)){
+		ADD_ELEMENT_TO_ARRAY(number_char_array, char, ch);
+		(*file_content_ptr)++;
+	}
+
+	char *number_literal_as_string = stringify_char_array(number_char_array);
+	double number_literal = strtod(number_literal_as_string, NULL);
+	free(number_literal_as_string);
+	
+	struct Token new_number_literal_token = {.type = TokenType_NUMBER, .line = lexer_data->current_line, .value = {.number = number_literal}};
+	ADD_ELEMENT_TO_ARRAY(lexer_data->tokens, struct Token, new_number_literal_token);
+	FreeArray(number_char_array);
+}
+
+static struct Array *lexer(const char *file_contents, size_t file_length, struct SymbolTable *symbols){
+#define HANDLE_SIMPLE_CHAR(token_type) \
+	{ \
+		struct Token new_token = {.type = token_type, .line = lexer_data->current_line, .value = {.number = ch}}; \
+		ADD_ELEMENT_TO_ARRAY(tokens, struct Token, new_token); \
+		break; \
+	}
+
+	struct LexerData *lexer_data = (struct LexerData*) malloc(sizeof(struct LexerData));
+	struct Array *tokens = CreateArray();
+	lexer_data->tokens = tokens;
+	lexer_data->file_contents = file_contents;
+	lexer_data->file_end = file_contents + file_length;
+	lexer_data->current_line = 1;
+	lexer_data->symbols = symbols;
+	
+	char ch;
+	while(file_contents < lexer_data->file_end && (ch = *(file_contents++)) != 0){
+		switch(ch){
+			case '\n':
+				lexer_data->current_line++;
+			case '\t':
+			case '\r':
+			case ' ':
+				break;
+
+			case '*': HANDLE_SIMPLE_CHAR(TokenType_STAR);
+			case '{': HANDLE_SIMPLE_CHAR(TokenType_LBRACE);
+			case '}': HANDLE_SIMPLE_CHAR(TokenType_RBRACE);
+			case '[': HANDLE_SIMPLE_CHAR(TokenType_LSQBRACE);
+			case ']': HANDLE_SIMPLE_CHAR(TokenType_RSQBRACE);
+			case '(': HANDLE_SIMPLE_CHAR(TokenType_LPAREN);
+			case ')': HANDLE_SIMPLE_CHAR(TokenType_RPAREN);
+			case ';': HANDLE_SIMPLE_CHAR(TokenType_SEMICOLON);
+			case ':': HANDLE_SIMPLE_CHAR(TokenType_COLON);
+
+			default:
+				if(isAlpha(ch)){
+					--file_contents;
+					handle_identifier(&file_contents, lexer_data);	
+				}else if(isNumber(ch)){
+					--file_contents;
+					handle_number_literal(&file_contents, lexer_data);
+				}else{
+					// Was not able to match the character to a handler
+					char *error_message = (char*) malloc(40);
+					snprintf(error_message, 40, "Was not able to match character \"%c\"", ch);
+					struct Token error_token = {.type = TokenType_ERROR, .line = lexer_data->current_line, .value = {.string = error_message}}; 
+					ADD_ELEMENT_TO_ARRAY(tokens, struct Token, error_token);
+				}
+		}
+	}
+	
+	struct Token eof_token = {.type = TokenType_EOF, .line = lexer_data->current_line};
+	ADD_ELEMENT_TO_ARRAY(tokens, struct Token, eof_token);
+	free(lexer_data); // TODO: Fix bug
+	return tokens;
+
+#undef HANDLE_SIMPLE_CHAR
+}
+
+enum CompilerResult {
+	CompilerResult_OK,
+	CompilerResult_PARSING_ERROR,
+	CompilerResult_CODE_GENERATION_ERROR,
+};
+
+#define OPCODE_LOADIMM 0b10010
+#define OPCODE_PUSH 0b10011
+#define OPCODE_POP 0b10100
+#define OPCODE_RESET 0b10101
+#define OPCODE_RESETALL 0b10110
+#define OPCODE_JMP 0b11101
+#define OPCODE_CJMP 0b11110
+#define OPCODE_HLT 0b11111
+
+// The ROM is split into banks, a jump only encodes the low 8 bits of its target and stays in its own bank
+#define BANK_SIZE 256
+#define BANK_COUNT 4
+
+struct Instruction{
+	int opcode;
+	int flags;
+	int parameter_1;
+	int parameter_2;
+	int label; // goto label whose line is patched into parameter_1 once every pass has run, -1 when there is none
+	int source_line; // for diagnostics, 0 for the instructions passes add
+};
+
+// Everything a single assembly needs lives here, so separate files can be assembled concurrently
+struct ParsingData{
+	struct Array* tokens;
+	struct SymbolTable* symbols;
+	int* goto_labels; // generated line of each label, indexed by the label's symbol index
+	int label_count; // labels created by passes are numbered after the ones from the source
+	int label_capacity;
+	int current_token_index;
+	int current_line; // source line of the statement being parsed, used for diagnostics
+	int current_mnemonic;
+	struct Instruction* instructions;
+	int instruction_count;
+	int instruction_capacity;
+	struct graphite_diag* diag;
+	struct Array* label_definitions; // every LabelDefinition in source order when set, used to merge chunks
+};
+
+struct LabelDefinition{
+	int label;
+	int line;
+};
+
+#define GET_CURRENT_TOKEN(p) \
+	GET_ELEMENT_FROM_ARRAY(p->tokens, struct Token, p->current_token_index)
+
+static void report_error(struct ParsingData *parsing_data, const char *format, ...){
+	// only the first error is kept, later ones are usually consequences of it
+	if(parsing_data->diag == NULL || parsing_data->diag->message[0] != 0) return;
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(parsing_data->diag->message, sizeof(parsing_data->diag->message), format, args);
+	va_end(args);
+
+	size_t length = strlen(parsing_data->diag->message);
+	if(length > 0 && parsing_data->diag->message[length - 1] == '\n') parsing_data->diag->message[length - 1] = 0;
+	parsing_data->diag->line = parsing_data->current_line;
+}
+
+static struct Token advance(struct ParsingData *parsing_data){
+	struct Token return_token = GET_ELEMENT_FROM_ARRAY(parsing_data->tokens, struct Token, parsing_data->current_token_index);
+	parsing_data->current_token_index++;
+	return return_token;
+}
+
+static int match(struct ParsingData *parsing_data, enum TokenType token_type){
+	if(parsing_data == NULL) return 0;
+	struct Token current_token = GET_CURRENT_TOKEN(parsing_data);
+	
+	if(current_token.type == token_type){
+		parsing_data->current_token_index++;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int is_finished_parsing_operand(struct Token token){
+	int return_value  = token.type == TokenType_SEMICOLON || token.type == TokenType_EOF;
+	return return_value;
+}
+
+#define OPERAND_DEREFERENCE 1
+#define OPERAND_PORT 2
+#define OPERAND_IDENTIFIER 4
+
+struct Operand{
+	union {
+		double number;
+		int symbol;
+	} value;
+	uint8_t flags;
+};
+
+enum OperandPrecedence{
+	OperandPrecedence_NONE,
+	OperandPrecedence_PARENTHESIS,
+	OperandPrecedence_SQBRACE,
+	OperandPrecedence_PRIMARY
+};
+
+struct OperandParseTableEntry{
+	enum CompilerResult (*handler)(struct ParsingData*, struct Operand*);
+	enum OperandPrecedence precedence;	
+};
+
+static enum CompilerResult paren_operand(struct ParsingData* parsing_data, struct Operand* operand);
+static enum CompilerResult brace_operand(struct ParsingData* parsing_data, struct Operand* operand);
+static enum CompilerResult primary_operand(struct ParsingData* parsing_data, struct Operand* operand);
+static const struct OperandParseTableEntry operand_parse_table[] = {
+	[TokenType_LPAREN]     = {paren_operand,   OperandPrecedence_PARENTHESIS},
+	[TokenType_LSQBRACE]   = {brace_operand,   OperandPrecedence_SQBRACE},
+	[TokenType_IDENTIFIER] = {primary_operand, OperandPrecedence_PRIMARY},
+	[TokenType_NUMBER]     = {primary_operand, OperandPrecedence_PRIMARY},
+};
+
+static enum CompilerResult parse_operand(struct ParsingData *parsing_data, struct Operand* operand, enum OperandPrecedence precedence){
+	// take the current token and figure out what to do with it
+	struct Token current_token = GET_CURRENT_TOKEN(parsing_data);
+	struct OperandParseTableEntry handler = {0};
+	if(current_token.type < sizeof(operand_parse_table) / sizeof(struct OperandParseTableEntry)) handler = operand_parse_table[current_token.type];
+
+	if(handler.precedence < precedence || handler.handler == NULL){
+		report_error(parsing_data, "[parse_operand] Was not able to find a handler for token type %d\n", current_token.type);
+		return CompilerResult_PARSING_ERROR;
+	}
+
+	return handler.handler(parsing_data, operand);
+}
+
+static enum CompilerResult paren_operand(struct ParsingData* parsing_data, struct Operand* operand){
+	// consume left parenthesis
+	advance(parsing_data);
+	operand->flags |= OPERAND_PORT;
+	
+	// parse the inner value
+	enum CompilerResult inner_value_result = 
+		parse_operand(parsing_data, operand, operand_parse_table[TokenType_LPAREN].precedence + 1);
+	
+	if(inner_value_result != CompilerResult_OK) return inner_value_result;
+	
+	// this should be right parenthesis
+	if(!match(parsing_data, TokenType_RPAREN)){
+		report_error(parsing_data, "Expected R_PAREN after inner value of parenthesis expression");
+		return CompilerResult_PARSING_ERROR;
+	}
+	
+	return CompilerResult_OK;	
+}
+
+static enum CompilerResult brace_operand(struct ParsingData* parsing_data, struct Operand* operand){
+	// consume left brace
+	advance(parsing_data);
+	operand->flags |= OPERAND_DEREFERENCE;
+	
+	// parse the inner value
+	enum CompilerResult inner_value_result = 
+		parse_operand(parsing_data, operand, operand_parse_table[TokenType_LBRACE].precedence + 1);
+	
+	if(inner_value_result != CompilerResult_OK) return inner_value_result;
+
+	// this should be right square brace
+	if(!match(parsing_data, TokenType_RSQBRACE)){
+		report_error(parsing_data, "Expected RSQ_BRACE after inner value of parenthesis expression");
+		return CompilerResult_PARSING_ERROR;
+	}
+
+	return CompilerResult_OK;	
+}
+
+static enum CompilerResult primary_operand(struct ParsingData* parsing_data, struct Operand* operand){
+	struct Token current_token = advance(parsing_data);
+	switch(current_token.type){
+		case TokenType_IDENTIFIER:
+			operand->value.symbol = current_token.value.symbol;
+			operand->flags |= OPERAND_IDENTIFIER;
+			break;
+		case TokenType_NUMBER:
+			operand->value.number = current_token.value.number;
+		default: break; // unreachable
+	}
+	
+	return CompilerResult_OK;
+}
+
+static enum CompilerResult parse_operands(struct ParsingData *parsing_data, struct Array **returned_operands){
+	struct Array *operands = CreateArray();
+	
+	while(!is_finished_parsing_operand(GET_CURRENT_TOKEN(parsing_data))){
+		// parse a single operand here
+		struct Operand operand = {0};
+		enum CompilerResult parse_status = parse_operand(parsing_data, &operand, OperandPrecedence_NONE);
+		if(parse_status != CompilerResult_OK){
+			FreeArray(operands);
+			return parse_status;
+		}
+		ADD_ELEMENT_TO_ARRAY(operands, struct Operand, operand);
+	}
+	
+	match(parsing_data, TokenType_SEMICOLON); // consumes semicolon at the end	
+	*returned_operands = operands;
+	return CompilerResult_OK;
+}
+
+static int is_operand_immediate(struct Operand operand){ return operand.flags == 0; }
+static int is_operand_identifier(struct Operand operand){ return operand.flags == OPERAND_IDENTIFIER; }
+static int is_operand_dereferenced_register(struct Operand operand){ return operand.flags == (OPERAND_IDENTIFIER | OPERAND_DEREFERENCE); }
+static int is_operand_immediate_memory(struct Operand operand){ return operand.flags == OPERAND_DEREFERENCE; }
+static int is_operand_immediate_port(struct Operand operand){ return operand.flags == OPERAND_DEREFERENCE; }
+
+#define REGISTER_IS_GPR 8
+#define REGISTER_READABLE_MAIN 4
+#define REGISTER_READABLE_SECONDARY 1
+#define REGISTER_WRITABLE 2
+struct Register{
+	const char *name;
+	int flags;
+};
+
+static const struct Register graphite_registers[] = {
+	[1] = (struct Register) { .name = "ax", .flags = 0b1111 },
+	[2] = (struct Register) { .name = "bx", .flags = 0b1111 },
+	[3] = (struct Register) { .name = "cx", .flags = 0b1111 },
+	[4] = (struct Register) { .name = "dx", .flags = 0b1111 },
+	[5] = (struct Register) { .name = "ex", .flags = 0b1111 },
+	[6] = (struct Register) { .name = "fx", .flags = 0b1111 },
+	[7] = (struct Register) { .name = "gx", .flags = 0b1111 },
+};
+
+static int get_register_index(int symbol){
+	return SYMBOL_KIND(symbol) == SymbolKind_REGISTER ? SYMBOL_INDEX(symbol) : -1;
+}
+
+static int verify_register_flags(int symbol, int flags){
+	int reg_index = get_register_index(symbol);
+	if(reg_index != -1){
+		if(graphite_registers[reg_index].flags & flags) return reg_index;
+	}
+	return -1;
+}
+
+static enum CompilerResult emit_instruction(struct ParsingData *parsing_data, int opcode_flags, int parameter_1, int parameter_2){
+	if(parsing_data->instruction_count == parsing_data->instruction_capacity){
+		parsing_data->instruction_capacity *= 2;
+		parsing_data->instructions = (struct Instruction*) realloc(parsing_data->instructions, sizeof(struct Instruction) * parsing_data->instruction_capacity);
+	}
+
+	parsing_data->instructions[parsing_data->instruction_count++] = (struct Instruction) {
+		.opcode = SYMBOL_INDEX(parsing_data->current_mnemonic),
+		.flags = opcode_flags,
+		.parameter_1 = parameter_1,
+		.parameter_2 = parameter_2,
+		.label = -1,
+		.source_line = parsing_data->current_line
+	};
+	return CompilerResult_OK;
+}
+
+static enum CompilerResult emit_label_reference(struct ParsingData *parsing_data, int opcode_flags, int label, int parameter_2){
+	enum CompilerResult result = emit_instruction(parsing_data, opcode_flags, 0, parameter_2);
+	parsing_data->instructions[parsing_data->instruction_count - 1].label = label;
+	return result;
+}
+
+static int create_label(struct ParsingData *parsing_data, int line){
+	if(parsing_data->label_count == parsing_data->label_capacity){
+		parsing_data->label_capacity *= 2;
+		parsing_data->goto_labels = (int*) realloc(parsing_data->goto_labels, sizeof(int) * parsing_data->label_capacity);
+	}
+
+	parsing_data->goto_labels[parsing_data->label_count] = line;
+	return parsing_data->label_count++;
+}
+
+// Patches the line of every referenced goto label into its instruction, labels may be used before they are defined
+static enum CompilerResult resolve_labels(struct ParsingData *parsing_data){
+	for(int i = 0; i < parsing_data->instruction_count; i++){
+		struct Instruction *instruction = &parsing_data->instructions[i];
+		if(instruction->label == -1) continue;
+
+		if(parsing_data->goto_labels[instruction->label] == -1){
+			parsing_data->current_line = instruction->source_line;
+			report_error(parsing_data, "Goto label %s is never defined\n", get_symbol_name(parsing_data->symbols, SYMBOL_ID(SymbolKind_LABEL, instruction->label)));
+			return CompilerResult_CODE_GENERATION_ERROR;
+		}
+		instruction->parameter_1 = parsing_data->goto_labels[instruction->label];
+	}
+
+	return CompilerResult_OK;
+}
+
+static uint32_t encode_instruction(struct Instruction instruction){
+	return (uint32_t) (instruction.opcode & 0b11111) << 19
+		| (uint32_t) (instruction.flags & 0b111) << 16
+		| (uint32_t) (instruction.parameter_1 & 0xff) << 8
+		| (uint32_t) (instruction.parameter_2 & 0xff);
+}
+
+// Right shift can only process numbers sent to the top input bus
+// This includes all of the registers, and immediates, immediate memory dereference, immediate io dereference
+static enum CompilerResult right_shift_handler(struct Array *operands, struct ParsingData *parsing_data){
+	if(operands->length < 1){
+		report_error(parsing_data, "Expected atleast one operand for rs mnemonic.\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	
+	if(is_operand_identifier(operand)){
+		int register_index;
+		if((register_index = verify_register_flags(operand.value.symbol, REGISTER_READABLE_MAIN)) != -1){
+			return emit_instruction(parsing_data, 0b001, register_index, 0);
+		}else{
+			report_error(parsing_data, "Expected register identifier which is readable through main bus. Received %s\n", get_symbol_name(parsing_data->symbols, operand.value.symbol));
+			return CompilerResult_CODE_GENERATION_ERROR;
+		}
+	}else if(is_operand_immediate(operand)){
+		return emit_instruction(parsing_data, 0b101, operand.value.number, 0);	
+	}else if(is_operand_immediate_memory(operand)){
+		return emit_instruction(parsing_data, 0b100, 0, operand.value.number);
+	}else if(is_operand_immediate_port(operand)){
+		return emit_instruction(parsing_data, 0b011, 0, operand.value.number);
+	}else{
+		report_error(parsing_data, "Expected either register, immediate, immediate memory or port address.\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+}
+
+// Negate can process numbers which can be sent to the bottom input bus
+// This includes most registers and immediates
+
+static enum CompilerResult negation_handler(struct Array *operands, struct ParsingData *parsing_data){
+	if(operands->length < 1){
+		report_error(parsing_data, "Expected atleast one operand for neg mnemonic.\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+
+	if(is_operand_identifier(operand)){
+		int register_index;
+		if((register_index = verify_register_flags(operand.value.symbol, REGISTER_READABLE_SECONDARY)) != -1){
+			return emit_instruction(parsing_data, 0b001, 0, register_index);
+		}else{
+			report_error(parsing_data, "Expected register identifier which is readable through secondary bus. Received %s\n", get_symbol_name(parsing_data->symbols, operand.value.symbol));
+		}
+	}else if(is_operand_immediate(operand)){
+		return emit_instruction(parsing_data, 0b101, 0, operand.value.number);
+	}else{
+		report_error(parsing_data, "Expected either register or immediate.\n");
+	}
+	
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+static enum CompilerResult arithmetic_handler(struct Array *operands, struct ParsingData *parsing_data){
+	if(operands->length < 2){
+		report_error(parsing_data, "Expected atleast two operands for arithmetic binary mnemonic\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	};
+	
+	struct Operand first_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	struct Operand second_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1);
+
+	// reg - reg, reg - imm, gpr - imm io, gpr - imm mem, imm - imm
+	// Perform recursive descent for the operands
+	if(is_operand_immediate(first_operand) && is_operand_immediate(second_operand)){
+		return emit_instruction(parsing_data, 0b101, first_operand.value.number, second_operand.value.number);
+	}
+
+	else if(is_operand_identifier(first_operand)){
+		int first_register_index;
+		if((first_register_index = get_register_index(first_operand.value.symbol)) != -1){
+			struct Register first_register = graphite_registers[first_register_index];
+			
+			if(first_register.flags & REGISTER_IS_GPR){
+				// check if the second operand is either an imm mem or imm io
+				int is_port;
+				if((is_port = is_operand_immediate_port(second_operand)) || is_operand_immediate_memory(second_operand)){
+					return emit_instruction(parsing_data, is_port ? 0b011 : 0b100, first_register_index, second_operand.value.number);
+				}
+			}
+
+			if(is_operand_immediate(second_operand)){
+				return emit_instruction(parsing_data, 0b010, first_register_index, second_operand.value.number);
+			}else if(is_operand_identifier(second_operand)){
+				int second_register_index;
+				if((second_register_index = verify_register_flags(second_operand.value.symbol, REGISTER_READABLE_SECONDARY)) != -1){
+						return emit_instruction(parsing_data, 0b001, first_register_index, second_register_index);
+				}else{
+					report_error(parsing_data, "Expected second operand to be register label readable using secondary bus. Received %s\n", get_symbol_name(parsing_data->symbols, second_operand.value.symbol));
+				}
+			}else{
+				report_error(parsing_data, "Was not able to match a handler for the second operand in arithmetic handler\n");
+			}
+		}else{
+			report_error(parsing_data, "Expected identifier to contain register label. Received %s\n", get_symbol_name(parsing_data->symbols, first_operand.value.symbol));
+		}
+	}else{
+		report_error(parsing_data, "Was not able to perform recursive descent parsing on the operands\n");
+	}
+
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+static enum CompilerResult mov_handler(struct Array *operands, struct ParsingData *parsing_data){
+	// Move from register to register
+	// Move from register to memory using register dereference
+	// Move from register to memory using immediate address
+	// Move from register to IO port using immediate address
+	// Move to register from memory using register dereference
+	// Move to register from memory using immediate address
+	// Move to register from IO port using immediate address
+	
+	if(operands->length < 2){
+		report_error(parsing_data, "Expected atleast two operands for mov command\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+	struct Operand first_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	struct Operand second_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1);
+
+	if(is_operand_identifier(first_operand)){
+		int first_register_index;
+		if((first_register_index = verify_register_flags(first_operand.value.symbol, REGISTER_READABLE_MAIN)) != -1){
+			if(is_operand_identifier(second_operand)){
+				int second_register_index;
+				if((second_register_index = verify_register_flags(second_operand.value.symbol, REGISTER_WRITABLE)) != -1){
+					return emit_instruction(parsing_data, 0b001, first_register_index, second_register_index);
+				}else{
+					report_error(parsing_data, "Expected second operand to contain register label that is writable. Received %s\n", get_symbol_name(parsing_data->symbols, second_operand.value.symbol));
+				}
+			}
+
+			else if(is_operand_dereferenced_register(second_operand)){
+				int second_register_index;
+				if((second_register_index = verify_register_flags(second_operand.value.symbol, REGISTER_READABLE_SECONDARY)) != -1){
+					return emit_instruction(parsing_data, 0b010, first_register_index, second_register_index);
+				}else{
+					report_error(parsing_data, "Expected second operand to contain register label that is readable through secondary bus. Received %s\n", get_symbol_name(parsing_data->symbols, second_operand.value.symbol));
+				}
+			}
+			
+			else if(is_operand_immediate_memory(second_operand)){
+				return emit_instruction(parsing_data, 0b011, first_register_index, second_operand.value.number);
+			}
+			
+			else if(is_operand_immediate_port(second_operand)){
+				return emit_instruction(parsing_data, 0b100, first_register_index, second_operand.value.number);
+			}
+		}else{
+			report_error(parsing_data, "Expected first operand to contain register label readable through the main bus. Received %s\n", get_symbol_name(parsing_data->symbols, first_operand.value.symbol));
+		}
+	}else if(is_operand_identifier(second_operand)){
+		int second_register_index;
+		if((second_register_index = verify_register_flags(second_operand.value.symbol, REGISTER_WRITABLE)) != -1){
+			if(is_operand_dereferenced_register(first_operand)){
+				int first_register_index;
+				if((first_register_index = verify_register_flags(first_operand.value.symbol, REGISTER_READABLE_SECONDARY)) != -1){
+					return emit_instruction(parsing_data, 0b101, first_register_index, second_register_index);
+				}else{
+					report_error(parsing_data, "Expected first operand to contain register label that is readable through secondary bus. Received %s\n", get_symbol_name(parsing_data->symbols, first_operand.value.symbol));
+				}
+			}else if(is_operand_immediate_memory(first_operand)){
+				return emit_instruction(parsing_data, 0b110, first_operand.value.number, second_register_index);
+			}else if(is_operand_immediate_port(first_operand)){
+				return emit_instruction(parsing_data, 0b111, first_operand.value.number, second_register_index);
+			}else{
+				report_error(parsing_data, "Expected first operand to either be register dereference, immediate memory address, or immediate port address\n");
+			}
+		}
+	}else{
+		report_error(parsing_data, "Was not able to perform recursive descent on the operands\n");
+	}
+
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+static enum CompilerResult loadimm_handler(struct Array *operands, struct ParsingData *parsing_data){
+	// Load immediate to register
+	// Load immediate to memory using register deref
+	// Load immediate to memory using immediate address
+	// Load immediate to port using immediate address
+	// Load immediate to port using register deref
+	if(operands->length < 2){
+		report_error(parsing_data, "Expected atleast two operands for loadimm mnemonic\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+	struct Operand first_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	struct Operand second_operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1);
+
+	if(is_operand_immediate(first_operand)){
+		if(second_operand.flags & OPERAND_IDENTIFIER){
+			int register_index;
+			if(second_operand.flags & OPERAND_DEREFERENCE){
+				if((register_index = verify_register_flags(second_operand.value.symbol, REGISTER_READABLE_SECONDARY)) != -1){
+					return emit_instruction(parsing_data, second_operand.flags & OPERAND_PORT ? 0b101 : 0b010, first_operand.value.number, register_index);
+				}else{
+					report_error(parsing_data, "Expected second operand to be register label readable through secondary bus. Received %s\n", get_symbol_name(parsing_data->symbols, second_operand.value.symbol));
+				}
+			}else{
+				if((register_index = verify_register_flags(second_operand.value.symbol, REGISTER_WRITABLE)) != -1){
+					return emit_instruction(parsing_data, 0b001, first_operand.value.number, register_index);
+				}else{
+					report_error(parsing_data, "Expected second operand to be register label that is writable. Received %s\n", get_symbol_name(parsing_data->symbols, second_operand.value.symbol));
+				}
+			}
+		}else if(second_operand.flags & OPERAND_DEREFERENCE || second_operand.flags & OPERAND_PORT){
+			return emit_instruction(parsing_data, second_operand.flags & OPERAND_PORT ? 0b100 : 0b011, first_operand.value.number, second_operand.value.number);
+		}else{
+			report_error(parsing_data, "Expected second parameter to either be register or dereferenced immediate\n");
+		}
+	}else{
+		report_error(parsing_data, "Expected first operand to be an immediate.\n");
+	}
+
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+static enum CompilerResult push_handler(struct Array *operands, struct ParsingData *parsing_data){
+	// Push register into stack
+	// Push immediate into stack
+	if(operands->length < 1){
+		report_error(parsing_data, "Expected atleast one operand for push mnemonic.\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	if(is_operand_identifier(operand)){
+		int register_index;
+		if((register_index = verify_register_flags(operand.value.symbol, REGISTER_READABLE_MAIN)) != -1){
+			return emit_instruction(parsing_data, 0b001, register_index, 0);
+		}else{
+			report_error(parsing_data, "Expected parameter to be register label that is readable through the main bus. Received %s\n", get_symbol_name(parsing_data->symbols, operand.value.symbol));
+		}
+	}else if(is_operand_immediate(operand)){
+		return emit_instruction(parsing_data, 0b010, operand.value.number, 0);
+	}else{
+		report_error(parsing_data, "Expected push parameter to be either register or immediate\n");
+	}
+
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+static enum CompilerResult pop_handler(struct Array *operands, struct ParsingData *parsing_data){
+	if(operands->length < 1){
+		report_error(parsing_data, "Expected atleast one operand for pop mnemonic.\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	if(is_operand_identifier(operand)){
+		int register_index;
+		if((register_index = verify_register_flags(operand.value.symbol, REGISTER_IS_GPR)) != -1){
+			return emit_instruction(parsing_data, 0b001, register_index, 0);
+		}else{
+			report_error(parsing_data, "Expected parameter to be general purpose register label\n");
+		}
+	}else{
+		report_error(parsing_data, "Expected operand to be identifie.\n");
+	}
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+static const char *const reset_targets[] = { NULL, "gpr", "mem", "stack", "io", "acc", "flag" };
+static enum CompilerResult reset_handler(struct Array *operands, struct ParsingData *parsing_data){
+	if(operands->length < 1){
+		report_error(parsing_data, "Expected atleast 1 operand for reset mnemonic.\n");
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+	
+	struct Operand operand = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	if(is_operand_identifier(operand)){
+		if(SYMBOL_KIND(operand.value.symbol) == SymbolKind_RESET_TARGET){
+			return emit_instruction(parsing_data, SYMBOL_INDEX(operand.value.symbol), 0, 0);
+		}
+
+		report_error(parsing_data, "Did not find reset target with the label of %s\n", get_symbol_name(parsing_data->symbols, operand.value.symbol));
+	}else{
+		report_error(parsing_data, "Expected operand to for reset mnemonic be identifier\n");
+	}
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+static enum CompilerResult nop_handler(struct Array *operands, struct ParsingData *parsing_data){
+	return emit_instruction(parsing_data, 0, 0, 0);
+}
+
+static enum CompilerResult jmp_handler(struct Array *operands, struct ParsingData *parsing_data){
+	// Jump immediate
+	// Jump from register
+	// Jump from immediate memory address
+	// Jump from dereferenced memory address
+	// Jump from immediate IO address
+	// Jump from dereferenced IO address
+	
+	int is_conditional = parsing_data->current_mnemonic == SYMBOL_ID(SymbolKind_MNEMONIC, OPCODE_CJMP);
+	if(operands->length < (is_conditional ? 2 : 1)){
+		report_error(parsing_data, "Expected atleast %d operands for %s mnemonic.\n", is_conditional ? 2 : 1, get_symbol_name(parsing_data->symbols, parsing_data->current_mnemonic));
+		return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+	struct Operand target = GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 0);
+	int flags = is_conditional ? (GET_ELEMENT_FROM_ARRAY(operands, struct Operand, 1)).value.number : 0;
+	
+	if(target.flags & OPERAND_IDENTIFIER){
+		int register_index;
+		if((register_index = get_register_index(target.value.symbol)) != -1){
+			if(target.flags & OPERAND_DEREFERENCE){
+				if(verify_register_flags(target.value.symbol, REGISTER_READABLE_SECONDARY) != -1){
+					return emit_instruction(parsing_data, target.flags & OPERAND_PORT ? 0b110 : 0b100, register_index, flags);
+				}else{
+					report_error(parsing_data, "Expected register to be readable through secondary bus\n");
+				}
+			}else{
+				if(verify_register_flags(target.value.symbol, REGISTER_READABLE_MAIN) != -1){
+					return emit_instruction(parsing_data, 0b010, register_index, flags);
+				}else{
+					report_error(parsing_data, "Expected register to be readable through main bus\n");
+				}	
+			}
+		}else{
+			// check if it's a goto label, its line is filled in by resolve_labels
+			if(SYMBOL_KIND(target.value.symbol) == SymbolKind_LABEL){
+				return emit_label_reference(parsing_data, 0b001, SYMBOL_INDEX(target.value.symbol), flags);
+			}else{
+				report_error(parsing_data, "Was not able to match identifier in goto parameter to either register or goto label");
+			}
+		}
+	}else if(target.value.number < 0 || target.value.number > 0xff){
+		// the target field only has 8 bits
+		report_error(parsing_data, "Jump target %g cannot be encoded, expected a value between 0 and 255\n", target.value.number);
+	}else{
+		if(target.flags & OPERAND_DEREFERENCE){
+			return emit_instruction(parsing_data, target.flags & OPERAND_PORT ? 0b101 : 0b011, target.value.number, flags);
+		}else{
+			return emit_instruction(parsing_data, 0b001, target.value.number, flags);
+		}
+	}
+	
+	return CompilerResult_CODE_GENERATION_ERROR;
+}
+
+struct Mnemonic{
+	const char *const name;
+	enum CompilerResult (*operand_handler)(struct Array *operands, struct ParsingData *parsing_data);
+};
+
+static const struct Mnemonic graphite_mnemonics[] = {
+	[0b00000] = { .name = "nop",      .operand_handler = &nop_handler  },
+	[0b00001] = { .name = "add",      .operand_handler = &arithmetic_handler  },
+	[0b00010] = { .name = "sub",      .operand_handler = &arithmetic_handler  },
+	[0b00011] = { .name = "xor",      .operand_handler = &arithmetic_handler  },
+	[0b00100] = { .name = "and",      .operand_handler = &arithmetic_handler  },
+	[0b00101] = { .name = "or",       .operand_handler = &arithmetic_handler  },
+	[0b00110] = { .name = "xnor",     .operand_handler = &arithmetic_handler  },
+	[0b00111] = { .name = "nand",     .operand_handler = &arithmetic_handler  },
+	[0b01000] = { .name = "nor",      .operand_handler = &arithmetic_handler  },
+	[0b01001] = { .name = "rs",       .operand_handler = &right_shift_handler },
+	[0b01010] = { .name = "neg",      .operand_handler = &negation_handler    },
+	[0b10001] = { .name = "mov",      .operand_handler = &mov_handler         },
+	[0b10010] = { .name = "loadimm",  .operand_handler = &loadimm_handler     },
+	[0b10011] = { .name = "push",     .operand_handler = &push_handler        },
+	[0b10100] = { .name = "pop",      .operand_handler = &pop_handler         },
+	[0b10101] = { .name = "reset",    .operand_handler = &reset_handler       },
+	[0b10110] = { .name = "resetall", .operand_handler = &nop_handler         },
+	[0b11101] = { .name = "jmp",      .operand_handler = &jmp_handler         },
+	[0b11110] = { .name = "cjmp",     .operand_handler = &jmp_handler         },
+	[0b11111] = { .name = "hlt",      .operand_handler = &nop_handler         },
+};
+
+static int find_index_of_mnemonic(int symbol){
+	return SYMBOL_KIND(symbol) == SymbolKind_MNEMONIC ? SYMBOL_INDEX(symbol) : -1;
+}
+
+static struct SymbolTable *create_symbol_table(){
+	struct SymbolTable *table = (struct SymbolTable*) malloc(sizeof(struct SymbolTable));
+	table->symbol_count = 0;
+	table->symbol_capacity = 64;
+	table->symbols = (struct Symbol*) malloc(sizeof(struct Symbol) * table->symbol_capacity);
+	table->slot_capacity = 128;
+	table->slots = (int*) malloc(sizeof(int) * table->slot_capacity);
+	memset(table->slots, -1, sizeof(int) * table->slot_capacity);
+	table->label_count = 0;
+
+	// predefine every reserved word so the lexer can tag identifiers with their kind
+	for(int i = 0; i < sizeof(graphite_mnemonics) / sizeof(struct Mnemonic); i++){
+		if(graphite_mnemonics[i].name == NULL) continue;
+		define_symbol(table, graphite_mnemonics[i].name, strlen(graphite_mnemonics[i].name), SYMBOL_ID(SymbolKind_MNEMONIC, i));
+	}
+
+	for(int i = 1; i < sizeof(graphite_registers) / sizeof(struct Register); i++){
+		define_symbol(table, graphite_registers[i].name, strlen(graphite_registers[i].name), SYMBOL_ID(SymbolKind_REGISTER, i));
+	}
+
+	for(int i = 1; i < sizeof(reset_targets) / sizeof(char*); i++){
+		define_symbol(table, reset_targets[i], strlen(reset_targets[i]), SYMBOL_ID(SymbolKind_RESET_TARGET, i));
+	}
+
+	return table;
+}
+
+static enum CompilerResult parse_token(struct ParsingData* parsing_data, struct Token first_token){
+	switch(first_token.type){
+		case TokenType_IDENTIFIER:{
+			int identifier_handler_index = find_index_of_mnemonic(first_token.value.symbol);
+			advance(parsing_data);
+			parsing_data->current_mnemonic = first_token.value.symbol;
+			
+			if(identifier_handler_index != -1){
+				const struct Mnemonic identifier_handler = graphite_mnemonics[identifier_handler_index];
+				struct Array *operands;
+				enum CompilerResult operand_parsing_status = parse_operands(parsing_data, &operands);
+				if(operand_parsing_status != CompilerResult_OK) return operand_parsing_status;
+				
+				enum CompilerResult parsing_status = identifier_handler.operand_handler(operands, parsing_data);
+				FreeArray(operands);
+				return parsing_status;
+			}
+
+			else{
+				if(SYMBOL_KIND(first_token.value.symbol) != SymbolKind_LABEL || !match(parsing_data, TokenType_COLON)){
+					report_error(parsing_data, "Identifier %s is not a mnemonic nor is it a goto label. Expected TokenType_COLON, Received: %d\n", get_symbol_name(parsing_data->symbols, first_token.value.symbol), (GET_CURRENT_TOKEN(parsing_data)).type);
+					return CompilerResult_PARSING_ERROR;
+				}
+
+				if(parsing_data->goto_labels[SYMBOL_INDEX(first_token.value.symbol)] != -1){
+					report_error(parsing_data, "Goto label %s is defined more than once\n", get_symbol_name(parsing_data->symbols, first_token.value.symbol));
+					return CompilerResult_PARSING_ERROR;
+				}
+
+				// add goto label here, labels do not take up a generated line themselves
+				parsing_data->goto_labels[SYMBOL_INDEX(first_token.value.symbol)] = parsing_data->instruction_count;
+				if(parsing_data->label_definitions != NULL){
+					struct LabelDefinition definition = { .label = SYMBOL_INDEX(first_token.value.symbol), .line = parsing_data->current_line };
+					ADD_ELEMENT_TO_ARRAY(parsing_data->label_definitions, struct LabelDefinition, definition);
+				}
+				return CompilerResult_OK;
+			}
+			
+			break;
+		}
+		
+		case TokenType_ERROR:
+			report_error(parsing_data, "%s\n", first_token.value.string);
+			return CompilerResult_PARSING_ERROR;
+
+		default:
+			report_error(parsing_data, "Was not able to find a handler for token type: %d\n", first_token.type);
+			return CompilerResult_PARSING_ERROR;
+	}
+}
+
+static enum CompilerResult parse(struct ParsingData* parsing_data){
+	struct Token current_token;
+	while((current_token = GET_CURRENT_TOKEN(parsing_data)).type != TokenType_EOF){
+		parsing_data->current_line = current_token.line;
+		enum CompilerResult result = parse_token(parsing_data, current_token);
+		if(result != CompilerResult_OK){
+			// not every failing handler explains itself, report_error keeps the message of the ones that do
+			report_error(parsing_data, "Was not able to assemble this statement\n");
+			return result;
+		}
+		// break; // remove this later, right now it only generates code for one line
+	}
+	
+	return CompilerResult_OK;
+}
+
+struct BasicBlock{
+	int start;
+	int end; // one past the last instruction
+	int fallthrough; // block reached when the last instruction does not jump, -1 when there is none
+	int target; // block the last instruction jumps to, -1 when there is none
+	int label; // label on the first instruction for jumps added by a pass, -1 until one is needed
+};
+
+static int is_jump(struct Instruction instruction){
+	return instruction.opcode == OPCODE_JMP || instruction.opcode == OPCODE_CJMP;
+}
+
+// Splits the instructions into basic blocks, returns -1 when control flow cannot be followed statically
+// (a jump through a register, memory or immediate address, or a jump past the last instruction).
+// Unless max_length is 0, longer blocks are cut into pieces of at most that length which fall through to each other.
+static int find_basic_blocks(struct ParsingData *parsing_data, int max_length, struct BasicBlock **returned_blocks, int **returned_block_of){
+	int count = parsing_data->instruction_count;
+	struct Instruction *instructions = parsing_data->instructions;
+	if(count == 0) return -1;
+
+	int *block_of = (int*) calloc(count, sizeof(int));
+	for(int i = 0; i < count; i++){
+		if(is_jump(instructions[i])){
+			if(instructions[i].label == -1) goto unknown_control_flow;
+			int line = parsing_data->goto_labels[instructions[i].label];
+			if(line == -1 || line >= count) goto unknown_control_flow;
+			block_of[line] = 1;
+		}
+		if((is_jump(instructions[i]) || instructions[i].opcode == OPCODE_HLT) && i + 1 < count) block_of[i + 1] = 1;
+	}
+	for(int i = 0; i < parsing_data->label_count; i++){
+		if(parsing_data->goto_labels[i] >= 0 && parsing_data->goto_labels[i] < count) block_of[parsing_data->goto_labels[i]] = 1;
+	}
+	for(int i = 1, length = 1; i < count && max_length > 0; i++){
+		if(length == max_length) block_of[i] = 1;
+		length = block_of[i] ? 1 : length + 1;
+	}
+
+	// block_of holds leader flags until here, turn it into the index of the block owning each instruction
+	int block_count = 0;
+	for(int i = 0; i < count; i++){
+		if(i == 0 || block_of[i]) block_count++;
+		block_of[i] = block_count - 1;
+	}
+
+	struct BasicBlock *blocks = (struct BasicBlock*) malloc(sizeof(struct BasicBlock) * block_count);
+	for(int i = 0; i < count; i++){
+		if(i == 0 || block_of[i] != block_of[i - 1]) blocks[block_of[i]].start = i;
+		blocks[block_of[i]].end = i + 1;
+	}
+
+	for(int b = 0; b < block_count; b++){
+		struct Instruction last = instructions[blocks[b].end - 1];
+		blocks[b].label = -1;
+		blocks[b].target = is_jump(last) ? block_of[parsing_data->goto_labels[last.label]] : -1;
+		blocks[b].fallthrough = last.opcode == OPCODE_JMP || last.opcode == OPCODE_HLT || b + 1 == block_count ? -1 : b + 1;
+	}
+
+	*returned_blocks = blocks;
+	*returned_block_of = block_of;
+	return block_count;
+
+unknown_control_flow:
+	free(block_of);
+	return -1;
+}
+
+static int falls_off_end(struct ParsingData *parsing_data, struct BasicBlock block){
+	struct Instruction last = parsing_data->instructions[block.end - 1];
+	return block.end == parsing_data->instruction_count && last.opcode != OPCODE_JMP && last.opcode != OPCODE_HLT;
+}
+
+static int get_block_label(struct ParsingData *parsing_data, struct BasicBlock *block){
+	if(block->label == -1) block->label = create_label(parsing_data, -1);
+	return block->label;
+}
+
+struct LayoutEdge{
+	int from;
+	int to;
+	uint64_t weight;
+	int is_fallthrough;
+};
+
+static int compare_layout_edges(const void *a, const void *b){
+	const struct LayoutEdge *first = (const struct LayoutEdge*) a, *second = (const struct LayoutEdge*) b;
+	if(first->weight != second->weight) return first->weight < second->weight ? 1 : -1;
+	// between equally hot edges keep the fall-throughs the source already has
+	if(first->is_fallthrough != second->is_fallthrough) return second->is_fallthrough - first->is_fallthrough;
+	return first->from - second->from;
+}
+
+// Number of profiled transfers that end up as a taken jump when the blocks are placed in this order.
+// Conditional jumps to their target are taken in every order so they have no edge.
+static uint64_t layout_cost(struct LayoutEdge *edges, int edge_count, int *next_in_layout){
+	uint64_t cost = 0;
+	for(int i = 0; i < edge_count; i++){
+		if(next_in_layout[edges[i].from] != edges[i].to) cost += edges[i].weight;
+	}
+	return cost;
+}
+
+// Reorders basic blocks so that the hottest successor of each block in the execution profile becomes its fall-through.
+// Chains are built greedily from the hottest edge down (Pettis-Hansen), unconditional jumps to the next block are
+// dropped and a jmp is added wherever a block no longer falls through to its old successor.
+static void layout_blocks(struct ParsingData *parsing_data, const struct graphite_profile_edge *profile, size_t profile_length){
+	struct BasicBlock *blocks;
+	int *block_of;
+	int block_count = find_basic_blocks(parsing_data, 0, &blocks, &block_of);
+	if(block_count <= 1){
+		if(block_count == 1){
+			free(blocks);
+			free(block_of);
+		}
+		return;
+	}
+
+	int count = parsing_data->instruction_count;
+	struct LayoutEdge *edges = (struct LayoutEdge*) malloc(sizeof(struct LayoutEdge) * block_count * 2);
+	int edge_count = 0;
+	for(int b = 0; b < block_count; b++){
+		// the entry block has to stay first, so nothing may be placed in front of it. A cjmp is never inverted, so its
+		// target cannot become a fall-through and chaining along it would only take the place of the one that can.
+		int is_unconditional = parsing_data->instructions[blocks[b].end - 1].opcode == OPCODE_JMP;
+		if(blocks[b].fallthrough > 0) edges[edge_count++] = (struct LayoutEdge) { b, blocks[b].fallthrough, 0, 1 };
+		if(blocks[b].target > 0 && is_unconditional) edges[edge_count++] = (struct LayoutEdge) { b, blocks[b].target, 0, 0 };
+	}
+
+	// profile edges are (index of the last instruction of a block, index it continued at, count)
+	for(size_t i = 0; i < profile_length; i++){
+		if(profile[i].from >= count || profile[i].to >= count) continue;
+		int from = block_of[profile[i].from], to = block_of[profile[i].to];
+		if(blocks[from].end - 1 != profile[i].from || blocks[to].start != profile[i].to) continue;
+
+		for(int e = 0; e < edge_count; e++){
+			if(edges[e].from == from && edges[e].to == to) edges[e].weight += profile[i].count;
+		}
+	}
+
+	qsort(edges, edge_count, sizeof(struct LayoutEdge), compare_layout_edges);
+
+	int *next_in_chain = (int*) malloc(sizeof(int) * block_count);
+	int *chain_head = (int*) malloc(sizeof(int) * block_count);
+	int *chain_tail = (int*) malloc(sizeof(int) * block_count);
+	for(int b = 0; b < block_count; b++){
+		next_in_chain[b] = -1;
+		chain_head[b] = b;
+		chain_tail[b] = b;
+	}
+
+	for(int e = 0; e < edge_count; e++){
+		int from = edges[e].from, to = edges[e].to;
+		if(chain_tail[chain_head[from]] != from || chain_head[to] != to || chain_head[from] == to) continue;
+
+		int head = chain_head[from];
+		next_in_chain[from] = to;
+		chain_tail[head] = chain_tail[to];
+		for(int b = to; b != -1; b = next_in_chain[b]) chain_head[b] = head;
+	}
+
+	// chains keep the source order of their heads, the entry chain comes first and a chain that runs off the end stays last
+	int *order = (int*) malloc(sizeof(int) * block_count);
+	int order_length = 0, last_chain = -1;
+	for(int b = 0; b < block_count; b++){
+		if(chain_head[b] != b) continue;
+		if(b != 0 && falls_off_end(parsing_data, blocks[chain_tail[b]])){
+			last_chain = b;
+			continue;
+		}
+		for(int c = b; c != -1; c = next_in_chain[c]) order[order_length++] = c;
+	}
+	for(int c = last_chain; c != -1; c = next_in_chain[c]) order[order_length++] = c;
+
+	int *next_in_layout = (int*) malloc(sizeof(int) * block_count);
+	int *original_next = (int*) malloc(sizeof(int) * block_count);
+	for(int i = 0; i < block_count; i++){
+		next_in_layout[order[i]] = i + 1 < block_count ? order[i + 1] : -1;
+		original_next[i] = i + 1 < block_count ? i + 1 : -1;
+	}
+
+	// when the entry chain is also the one running off the end it cannot be both first and last, so the source order is kept
+	int entry_runs_off_end = falls_off_end(parsing_data, blocks[chain_tail[0]]) && chain_tail[0] != order[block_count - 1];
+	if(!entry_runs_off_end && layout_cost(edges, edge_count, next_in_layout) < layout_cost(edges, edge_count, original_next)){
+		int original_label_count = parsing_data->label_count;
+		int *new_start = (int*) malloc(sizeof(int) * block_count);
+		struct Instruction *instructions = (struct Instruction*) malloc(sizeof(struct Instruction) * (count + block_count));
+		int instruction_count = 0;
+
+		for(int i = 0; i < block_count; i++){
+			struct BasicBlock *block = &blocks[order[i]];
+			int next = next_in_layout[order[i]];
+			new_start[order[i]] = instruction_count;
+
+			int end = block->end;
+			if(parsing_data->instructions[end - 1].opcode == OPCODE_JMP && block->target == next) end--;
+			for(int j = block->start; j < end; j++) instructions[instruction_count++] = parsing_data->instructions[j];
+
+			if(block->fallthrough != -1 && block->fallthrough != next){
+				instructions[instruction_count++] = (struct Instruction) {
+					.opcode = OPCODE_JMP, .flags = 0b001, .parameter_1 = 0, .parameter_2 = 0,
+					.label = get_block_label(parsing_data, &blocks[block->fallthrough])
+				};
+			}
+		}
+
+		for(int i = 0; i < original_label_count; i++){
+			int line = parsing_data->goto_labels[i];
+			if(line == -1) continue;
+			parsing_data->goto_labels[i] = line >= count ? instruction_count : new_start[block_of[line]];
+		}
+		for(int b = 0; b < block_count; b++){
+			if(blocks[b].label != -1) parsing_data->goto_labels[blocks[b].label] = new_start[b];
+		}
+
+		free(parsing_data->instructions);
+		parsing_data->instructions = instructions;
+		parsing_data->instruction_count = instruction_count;
+		parsing_data->instruction_capacity = count + block_count;
+		free(new_start);
+	}
+
+	free(original_next);
+	free(next_in_layout);
+	free(order);
+	free(chain_tail);
+	free(chain_head);
+	free(next_in_chain);
+	free(edges);
+	free(blocks);
+	free(block_of);
+}
+
+static int is_alu_opcode(int opcode){
+	return graphite_mnemonics[opcode].operand_handler == arithmetic_handler || graphite_mnemonics[opcode].operand_handler == right_shift_handler
+		|| graphite_mnemonics[opcode].operand_handler == negation_handler;
+}
+
+// ALU instructions read their operands and leave the result in the accumulator and the flags, no register is written.
+// Both are set again by the next ALU instruction, so they are dead when one comes before anything can read them.
+// The accumulator is not an operand of any instruction, so everything but nop, reset and the ALU instructions is
+// taken to read it.
+static int is_alu_state_dead_after(struct ParsingData *parsing_data, int index){
+	int are_flags_live = 1, is_accumulator_live = 1;
+	for(int i = index; i < parsing_data->instruction_count; i++){
+		struct Instruction instruction = parsing_data->instructions[i];
+		if(is_alu_opcode(instruction.opcode) || instruction.opcode == OPCODE_RESETALL) return 1;
+		if(instruction.opcode == OPCODE_RESET){
+			if(instruction.flags == 5) is_accumulator_live = 0; // reset acc
+			if(instruction.flags == 6) are_flags_live = 0; // reset flag
+			if(!are_flags_live && !is_accumulator_live) return 1;
+			continue;
+		}
+		if(instruction.opcode != 0) return 0;
+	}
+	return 0;
+}
+
+// Removes the ALU instructions whose result nothing reads. Since an ALU result only depends on the operands, a run of
+// ALU instructions is equivalent to its last one and there is no shorter sequence to find than that.
+// Port operands are kept since reading a port may have effects. Nothing is done unless every jump goes to a label,
+// since removing instructions would break computed targets.
+static void remove_dead_alu(struct ParsingData *parsing_data){
+	struct BasicBlock *blocks;
+	int *block_of;
+	if(find_basic_blocks(parsing_data, 0, &blocks, &block_of) == -1) return;
+	free(blocks);
+	free(block_of);
+
+	// a removed instruction has no effect, so a label on it can move to the next one
+	int count = parsing_data->instruction_count;
+	int *new_index = (int*) malloc(sizeof(int) * (count + 1));
+	int instruction_count = 0;
+	for(int i = 0; i < count; i++){
+		struct Instruction instruction = parsing_data->instructions[i];
+		new_index[i] = instruction_count;
+
+		int reads_port = instruction.flags == 0b011 && graphite_mnemonics[instruction.opcode].operand_handler != negation_handler;
+		if(is_alu_opcode(instruction.opcode) && !reads_port && is_alu_state_dead_after(parsing_data, i + 1)) continue;
+		parsing_data->instructions[instruction_count++] = instruction;
+	}
+	new_index[count] = instruction_count;
+
+	for(int i = 0; i < parsing_data->label_count; i++){
+		if(parsing_data->goto_labels[i] >= 0) parsing_data->goto_labels[i] = new_index[parsing_data->goto_labels[i]];
+	}
+	parsing_data->instruction_count = instruction_count;
+	free(new_index);
+}
+
+#define MAX_OUTLINE_LENGTH 32
+
+static int is_same_instruction(struct Instruction first, struct Instruction second){
+	return first.opcode == second.opcode && first.flags == second.flags && first.parameter_1 == second.parameter_1
+		&& first.parameter_2 == second.parameter_2 && first.label == second.label;
+}
+
+static int ends_fallthrough(struct Instruction instruction){
+	return instruction.opcode == OPCODE_JMP || instruction.opcode == OPCODE_HLT;
+}
+
+// FNV-1a over the encoded instructions and their labels
+static uint32_t hash_instructions(struct Instruction *instructions, int start, int length){
+	uint32_t hash = 2166136261u;
+	for(int i = start; i < start + length; i++){
+		uint32_t words[2] = { encode_instruction(instructions[i]), (uint32_t) instructions[i].label };
+		for(int j = 0; j < 2; j++){
+			for(int b = 0; b < 4; b++){
+				hash ^= (words[j] >> (b * 8)) & 0xff;
+				hash *= 16777619u;
+			}
+		}
+	}
+	return hash;
+}
+
+// Bit n is set when the instruction names register n in one of its operands
+static int get_used_registers(struct Instruction instruction){
+	enum CompilerResult (*handler)(struct Array*, struct ParsingData*) = graphite_mnemonics[instruction.opcode].operand_handler;
+	int p1 = instruction.parameter_1 >= 0 && instruction.parameter_1 < 8 ? 1 << instruction.parameter_1 : 0;
+	int p2 = instruction.parameter_2 >= 0 && instruction.parameter_2 < 8 ? 1 << instruction.parameter_2 : 0;
+	int used = 0;
+
+	if(handler == arithmetic_handler){
+		if(instruction.flags == 0b001) used = p1 | p2;
+		else if(instruction.flags != 0b101) used = p1;
+	}else if(handler == right_shift_handler){
+		if(instruction.flags == 0b001) used = p1;
+	}else if(handler == negation_handler){
+		if(instruction.flags == 0b001) used = p2;
+	}else if(handler == mov_handler){
+		if(instruction.flags == 0b001 || instruction.flags == 0b010 || instruction.flags == 0b101) used = p1 | p2;
+		else if(instruction.flags == 0b011 || instruction.flags == 0b100) used = p1;
+		else used = p2;
+	}else if(handler == loadimm_handler){
+		if(instruction.flags == 0b001 || instruction.flags == 0b010 || instruction.flags == 0b101) used = p2;
+	}else if(handler == push_handler || handler == pop_handler){
+		if(instruction.flags == 0b001) used = p1;
+	}else if(handler == jmp_handler){
+		if(instruction.flags == 0b010 || instruction.flags == 0b100 || instruction.flags == 0b110) used = p1;
+	}
+	return used & ~1;
+}
+
+struct TailMerge{
+	int removed_end; // last instruction of the tail that is replaced
+	int kept_end; // last instruction of the identical tail it is replaced with
+	int length;
+	int saved;
+};
+
+static int compare_tail_merges(const void *a, const void *b){
+	const struct TailMerge *first = (const struct TailMerge*) a, *second = (const struct TailMerge*) b;
+	if(first->saved != second->saved) return second->saved - first->saved;
+	return first->removed_end - second->removed_end;
+}
+
+struct HashedPosition{
+	uint32_t hash;
+	int index;
+};
+
+static int compare_hashed_positions(const void *a, const void *b){
+	const struct HashedPosition *first = (const struct HashedPosition*) a, *second = (const struct HashedPosition*) b;
+	if(first->hash != second->hash) return first->hash < second->hash ? -1 : 1;
+	return first->index - second->index;
+}
+
+// Replaces instruction runs that end in jmp or hlt with a jump to an identical run elsewhere,
+// labels inside a replaced run move to the same offset in the run that is kept. Returns the slots saved.
+static int merge_tails(struct ParsingData *parsing_data){
+	int count = parsing_data->instruction_count;
+	struct Instruction *instructions = parsing_data->instructions;
+
+	// tails are bucketed by their last two instructions, only runs within a bucket can be worth merging
+	struct HashedPosition *ends = (struct HashedPosition*) malloc(sizeof(struct HashedPosition) * count);
+	int end_count = 0;
+	for(int i = 0; i < count; i++){
+		if(!ends_fallthrough(instructions[i])) continue;
+		ends[end_count++] = (struct HashedPosition) { hash_instructions(instructions, i > 0 ? i - 1 : i, i > 0 ? 2 : 1), i };
+	}
+	qsort(ends, end_count, sizeof(struct HashedPosition), compare_hashed_positions);
+
+	struct Array *merges = CreateArray();
+	for(int first = 0; first < end_count;){
+		int last = first;
+		while(last < end_count && ends[last].hash == ends[first].hash) last++;
+
+		for(int i = first; i < last; i++){
+			for(int j = first; j < last; j++){
+				// a is kept, b is replaced; the runs may not overlap
+				int a = ends[i].index, b = ends[j].index, length = 0;
+				if(a == b) continue;
+				int limit = a < b ? b - a : a - b;
+				while(length < limit && length <= a && length <= b && is_same_instruction(instructions[a - length], instructions[b - length])) length++;
+
+				int start = b - length + 1;
+				int needs_jump = start == 0 || !ends_fallthrough(instructions[start - 1]);
+				struct TailMerge merge = { .removed_end = b, .kept_end = a, .length = length, .saved = length - needs_jump };
+				if(length > 0 && merge.saved > 0) ADD_ELEMENT_TO_ARRAY(merges, struct TailMerge, merge);
+			}
+		}
+		first = last;
+	}
+
+	struct TailMerge *sorted_merges = (struct TailMerge*) malloc(sizeof(struct TailMerge) * (merges->length + 1));
+	for(int i = 0; i < merges->length; i++) sorted_merges[i] = GET_ELEMENT_FROM_ARRAY(merges, struct TailMerge, i);
+	qsort(sorted_merges, merges->length, sizeof(struct TailMerge), compare_tail_merges);
+
+	// 1 for instructions of a kept run, 2 for instructions of a replaced run
+	int *state = (int*) calloc(count, sizeof(int));
+	int *replaced_by = (int*) malloc(sizeof(int) * count);
+	int *jump_label = (int*) malloc(sizeof(int) * count);
+	for(int i = 0; i < count; i++){
+		replaced_by[i] = -1;
+		jump_label[i] = -1;
+	}
+
+	int saved = 0;
+	for(int m = 0; m < merges->length; m++){
+		struct TailMerge merge = sorted_merges[m];
+		int removed_start = merge.removed_end - merge.length + 1, kept_start = merge.kept_end - merge.length + 1;
+		int is_free = 1;
+		for(int i = 0; i < merge.length; i++){
+			is_free &= state[removed_start + i] == 0 && state[kept_start + i] != 2;
+		}
+		if(!is_free) continue;
+
+		for(int i = 0; i < merge.length; i++){
+			state[removed_start + i] = 2;
+			state[kept_start + i] = 1;
+			replaced_by[removed_start + i] = kept_start + i;
+		}
+		if(merge.saved < merge.length) jump_label[removed_start] = create_label(parsing_data, kept_start);
+		saved += merge.saved;
+	}
+
+	if(saved > 0){
+		int *new_index = (int*) malloc(sizeof(int) * (count + 1));
+		struct Instruction *merged = (struct Instruction*) malloc(sizeof(struct Instruction) * count);
+		int merged_count = 0;
+		for(int i = 0; i < count; i++){
+			if(jump_label[i] != -1){
+				merged[merged_count++] = (struct Instruction) { .opcode = OPCODE_JMP, .flags = 0b001, .parameter_1 = 0, .parameter_2 = 0, .label = jump_label[i] };
+			}
+			if(state[i] != 2){
+				new_index[i] = merged_count;
+				merged[merged_count++] = instructions[i];
+			}
+		}
+		new_index[count] = merged_count;
+		for(int i = 0; i < count; i++){
+			if(state[i] == 2) new_index[i] = new_index[replaced_by[i]];
+		}
+
+		for(int i = 0; i < parsing_data->label_count; i++){
+			if(parsing_data->goto_labels[i] >= 0) parsing_data->goto_labels[i] = new_index[parsing_data->goto_labels[i]];
+		}
+
+		free(parsing_data->instructions);
+		parsing_data->instructions = merged;
+		parsing_data->instruction_count = merged_count;
+		parsing_data->instruction_capacity = count;
+		free(new_index);
+	}
+
+	free(jump_label);
+	free(replaced_by);
+	free(state);
+	free(sorted_merges);
+	FreeArray(merges);
+	free(ends);
+	return saved;
+}
+
+// Moves the most profitable repeated run into a subroutine at the end of the program, returns the slots saved or 0.
+// Each occurrence becomes "push <return>; jmp <body>" and the body is "pop scratch; <run>; jmp scratch".
+static int outline_run(struct ParsingData *parsing_data, int scratch, int **is_outlined){
+	int count = parsing_data->instruction_count;
+	struct Instruction *instructions = parsing_data->instructions;
+
+	// runs may not contain control flow, anything that clobbers the scratch register, label references or jump targets past their start
+	int *can_start = (int*) malloc(sizeof(int) * (count + 1));
+	int *can_continue = (int*) malloc(sizeof(int) * (count + 1));
+	int *is_label_target = (int*) calloc(count + 1, sizeof(int));
+	for(int i = 0; i < parsing_data->label_count; i++){
+		if(parsing_data->goto_labels[i] >= 0) is_label_target[parsing_data->goto_labels[i]] = 1;
+	}
+	for(int i = 0; i < count; i++){
+		int opcode = instructions[i].opcode;
+		can_start[i] = !is_jump(instructions[i]) && opcode != OPCODE_HLT && opcode != OPCODE_RESET && opcode != OPCODE_RESETALL
+			&& instructions[i].label == -1 && !(*is_outlined)[i];
+		can_continue[i] = can_start[i] && !is_label_target[i];
+	}
+
+	// length of the straight-line run that may be outlined from each instruction
+	int *run_length = (int*) malloc(sizeof(int) * (count + 1));
+	run_length[count] = 0;
+	for(int i = count - 1; i >= 0; i--){
+		int continued = i + 1 < count && can_continue[i + 1] ? run_length[i + 1] : 0;
+		run_length[i] = can_start[i] ? 1 + (continued < MAX_OUTLINE_LENGTH - 1 ? continued : MAX_OUTLINE_LENGTH - 1) : 0;
+	}
+
+	struct HashedPosition *windows = (struct HashedPosition*) malloc(sizeof(struct HashedPosition) * (count + 1));
+	int *is_grouped = (int*) malloc(sizeof(int) * (count + 1));
+	int *occurrences = (int*) malloc(sizeof(int) * (count + 1));
+	int *best_occurrences = (int*) malloc(sizeof(int) * (count + 1));
+	int best_saved = 0, best_length = 0, best_count = 0;
+
+	for(int length = 3; length <= MAX_OUTLINE_LENGTH && length <= count; length++){
+		int window_count = 0;
+		for(int i = 0; i + length <= count; i++){
+			if(run_length[i] >= length) windows[window_count++] = (struct HashedPosition) { hash_instructions(instructions, i, length), i };
+		}
+		qsort(windows, window_count, sizeof(struct HashedPosition), compare_hashed_positions);
+		for(int i = 0; i < window_count; i++) is_grouped[i] = 0;
+
+		for(int i = 0; i < window_count; i++){
+			if(is_grouped[i]) continue;
+
+			// windows are sorted by position within a hash, so taking every match that starts past the previous one keeps them apart
+			int occurrence_count = 0, previous_end = -1;
+			for(int j = i; j < window_count && windows[j].hash == windows[i].hash; j++){
+				if(is_grouped[j]) continue;
+				int is_match = 1;
+				for(int k = 0; k < length && is_match; k++) is_match = is_same_instruction(instructions[windows[i].index + k], instructions[windows[j].index + k]);
+				if(!is_match) continue;
+
+				is_grouped[j] = 1;
+				if(windows[j].index < previous_end) continue;
+				occurrences[occurrence_count++] = windows[j].index;
+				previous_end = windows[j].index + length;
+			}
+
+			// every occurrence costs a push and a jmp, the body adds a pop and a jmp
+			int saved = occurrence_count * length - occurrence_count * 2 - length - 2;
+			if(saved > best_saved){
+				best_saved = saved;
+				best_length = length;
+				best_count = occurrence_count;
+				memcpy(best_occurrences, occurrences, sizeof(int) * occurrence_count);
+			}
+		}
+	}
+
+	if(best_saved > 0){
+		int body_label = create_label(parsing_data, -1);
+		int new_count = count - best_count * best_length + best_count * 2 + best_length + 2;
+		int *new_index = (int*) malloc(sizeof(int) * (count + 1));
+		struct Instruction *outlined = (struct Instruction*) malloc(sizeof(struct Instruction) * new_count);
+		int *now_outlined = (int*) calloc(new_count, sizeof(int));
+		int outlined_count = 0;
+
+		for(int i = 0, o = 0; i < count;){
+			if(o < best_count && best_occurrences[o] == i){
+				int return_label = create_label(parsing_data, -1);
+				for(int k = 0; k < best_length; k++) new_index[i + k] = outlined_count;
+				outlined[outlined_count++] = (struct Instruction) { .opcode = OPCODE_PUSH, .flags = 0b010, .parameter_1 = 0, .parameter_2 = 0, .label = return_label };
+				outlined[outlined_count++] = (struct Instruction) { .opcode = OPCODE_JMP, .flags = 0b001, .parameter_1 = 0, .parameter_2 = 0, .label = body_label };
+				parsing_data->goto_labels[return_label] = outlined_count;
+				i += best_length;
+				o++;
+				continue;
+			}
+			now_outlined[outlined_count] = (*is_outlined)[i];
+			new_index[i] = outlined_count;
+			outlined[outlined_count++] = instructions[i++];
+		}
+		new_index[count] = outlined_count;
+
+		// the last instruction is a jmp or hlt so the body is only entered through the calls
+		int body_start = outlined_count;
+		outlined[outlined_count++] = (struct Instruction) { .opcode = OPCODE_POP, .flags = 0b001, .parameter_1 = scratch, .parameter_2 = 0, .label = -1 };
+		for(int k = 0; k < best_length; k++) outlined[outlined_count++] = instructions[best_occurrences[0] + k];
+		outlined[outlined_count++] = (struct Instruction) { .opcode = OPCODE_JMP, .flags = 0b010, .parameter_1 = scratch, .parameter_2 = 0, .label = -1 };
+		for(int i = body_start; i < outlined_count; i++) now_outlined[i] = 1;
+
+		// labels created above already hold new lines
+		for(int i = 0; i < body_label; i++){
+			if(parsing_data->goto_labels[i] >= 0) parsing_data->goto_labels[i] = new_index[parsing_data->goto_labels[i]];
+		}
+		parsing_data->goto_labels[body_label] = body_start;
+
+		free(parsing_data->instructions);
+		parsing_data->instructions = outlined;
+		parsing_data->instruction_count = outlined_count;
+		parsing_data->instruction_capacity = new_count;
+		free(*is_outlined);
+		*is_outlined = now_outlined;
+		free(new_index);
+	}
+
+	free(best_occurrences);
+	free(occurrences);
+	free(is_grouped);
+	free(windows);
+	free(run_length);
+	free(is_label_target);
+	free(can_continue);
+	free(can_start);
+	return best_saved;
+}
+
+// General purpose register no instruction names, -1 when there is none
+static int find_scratch_register(struct ParsingData *parsing_data){
+	int used_registers = 0, scratch = -1;
+	for(int i = 0; i < parsing_data->instruction_count; i++) used_registers |= get_used_registers(parsing_data->instructions[i]);
+	for(int r = 7; r >= 1 && scratch == -1; r--){
+		if(!(used_registers & (1 << r))) scratch = r;
+	}
+	return scratch;
+}
+
+// Shrinks the program by merging identical tails and outlining repeated runs into subroutines.
+// Nothing is done unless every jump goes to a label, since moving code would break computed targets.
+static void compact_code(struct ParsingData *parsing_data, struct graphite_stats *stats){
+	if(stats != NULL) *stats = (struct graphite_stats) { .tail_merge_saved = 0, .outline_saved = 0 };
+
+	struct BasicBlock *blocks;
+	int *block_of;
+	if(find_basic_blocks(parsing_data, 0, &blocks, &block_of) == -1) return;
+	free(blocks);
+	free(block_of);
+
+	int tail_merge_saved = 0, saved;
+	while((saved = merge_tails(parsing_data)) > 0) tail_merge_saved += saved;
+
+	// subroutines return through a register the program never names, and are placed after a final jmp or hlt.
+	// The return jump stays in its bank, so nothing is outlined from programs that do not fit in one.
+	int scratch = find_scratch_register(parsing_data);
+
+	int outline_saved = 0;
+	if(scratch != -1 && parsing_data->instruction_count <= BANK_SIZE && ends_fallthrough(parsing_data->instructions[parsing_data->instruction_count - 1])){
+		int *is_outlined = (int*) calloc(parsing_data->instruction_count, sizeof(int));
+		while((saved = outline_run(parsing_data, scratch, &is_outlined)) > 0) outline_saved += saved;
+		free(is_outlined);
+	}
+
+	if(stats != NULL){
+		stats->tail_merge_saved = tail_merge_saved;
+		stats->outline_saved = outline_saved;
+	}
+}
+
+// Index of the first jump whose label is in another bank, -1 when there is none
+static int find_cross_bank_jump(struct ParsingData *parsing_data){
+	for(int i = 0; i < parsing_data->instruction_count; i++){
+		struct Instruction instruction = parsing_data->instructions[i];
+		if(instruction.label == -1 || !is_jump(instruction) || parsing_data->goto_labels[instruction.label] == -1) continue;
+		if(parsing_data->goto_labels[instruction.label] / BANK_SIZE != i / BANK_SIZE) return i;
+	}
+	return -1;
+}
+
+// A jump that cannot be kept in its bank goes through trampolines. The last slot of a bank becomes a nop pad which runs
+// into a dispatcher on the first slot of the next bank, so jumping to the pad continues execution in the next bank.
+// A dispatcher jumps on directly when every trampoline through it has the same next hop, the target or the pad of the
+// next bank. Otherwise it jumps through a register the program never names, which the jumps through it load first:
+// with the low bits of their target when it is their last dispatcher, with the last slot of the bank to go on otherwise.
+#define HOP_UNUSED -1
+#define HOP_NEXT_PAD -2
+#define HOP_MIXED -3
+
+// Placing adds at most a loadimm in front of the jump ending a block and a jmp with its loadimm after it, so blocks
+// this long always fit between a dispatcher and the next pad. Longer runs are cut into pieces of this length.
+#define MAX_PLACED_BLOCK_LENGTH (BANK_SIZE - 2 - 3)
+
+enum PlacementFailure{
+	PlacementFailure_NONE,
+	PlacementFailure_ENTRY_BLOCK,
+	PlacementFailure_BACKWARD_JUMP,
+	PlacementFailure_MIXED_DISPATCHER,
+	PlacementFailure_NO_SCRATCH_REGISTER,
+	PlacementFailure_TOO_MANY_BANKS
+};
+
+// Every block has two jump sites, 2 * block is the jump ending the block and 2 * block + 1 the jmp added after it when
+// its fall-through has to be broken. The flags only ever go from 0 to 1 and a block moves at most into the next bank,
+// so there are at most two banks per block and placing until no flag changes comes to an end.
+struct BankPlacement{
+	int *new_start;
+	int *is_broken; // the block ends with an added jmp to its fall-through
+	int *uses_register; // per jump site, the scratch register is loaded for a dispatcher in front of the jump
+	int *is_gated; // per bank, its last slot and the first slot of the next bank hold a trampoline
+	int *next_hop; // per bank, the block the dispatcher after it jumps to or one of the HOP values
+	int bank_capacity;
+	int line_count;
+	int crossing_count; // jump sites going through trampolines
+	enum PlacementFailure failure;
+	int failed_site; // the bank of the dispatcher for PlacementFailure_MIXED_DISPATCHER
+};
+
+static int get_placed_block_size(struct BasicBlock *blocks, const struct BankPlacement *placement, int block){
+	return blocks[block].end - blocks[block].start + placement->uses_register[2 * block]
+		+ placement->is_broken[block] * (1 + placement->uses_register[2 * block + 1]);
+}
+
+static int get_site_target(struct BasicBlock *blocks, const struct BankPlacement *placement, int site){
+	if(site % 2 == 0) return blocks[site / 2].target;
+	return placement->is_broken[site / 2] ? blocks[site / 2].fallthrough : -1;
+}
+
+// Line of the jump instruction of a site
+static int get_site_line(struct BasicBlock *blocks, const struct BankPlacement *placement, int site){
+	int block = site / 2;
+	int line = placement->new_start[block] + blocks[block].end - blocks[block].start + placement->uses_register[2 * block] - 1;
+	return site % 2 == 0 ? line : line + 1 + placement->uses_register[site];
+}
+
+static void grow_bank_flags(struct BankPlacement *placement, int bank_count){
+	int capacity = placement->bank_capacity;
+	if(bank_count <= capacity) return;
+	while(placement->bank_capacity < bank_count) placement->bank_capacity *= 2;
+	placement->is_gated = (int*) realloc(placement->is_gated, sizeof(int) * placement->bank_capacity);
+	placement->next_hop = (int*) realloc(placement->next_hop, sizeof(int) * placement->bank_capacity);
+	memset(placement->is_gated + capacity, 0, sizeof(int) * (placement->bank_capacity - capacity));
+}
+
+// Bank of the first trampoline whose pad or dispatcher lies in [start, end), -1 when there is none
+static int find_gate_in(const struct BankPlacement *placement, int start, int end){
+	for(int bank = start / BANK_SIZE; bank <= (end - 1) / BANK_SIZE && bank <= placement->bank_capacity; bank++){
+		if(bank > 0 && placement->is_gated[bank - 1] && bank * BANK_SIZE >= start) return bank - 1;
+		if(bank < placement->bank_capacity && placement->is_gated[bank] && bank * BANK_SIZE + BANK_SIZE - 1 < end) return bank;
+	}
+	return -1;
+}
+
+static void find_next_hops(struct BasicBlock *blocks, int block_count, struct BankPlacement *placement){
+	for(int bank = 0; bank < placement->bank_capacity; bank++) placement->next_hop[bank] = HOP_UNUSED;
+	for(int site = 0; site < block_count * 2; site++){
+		int target = get_site_target(blocks, placement, site);
+		if(target == -1) continue;
+
+		int to = placement->new_start[target] / BANK_SIZE;
+		for(int bank = get_site_line(blocks, placement, site) / BANK_SIZE; bank < to; bank++){
+			int hop = bank == to - 1 ? target : HOP_NEXT_PAD;
+			if(placement->next_hop[bank] == HOP_UNUSED) placement->next_hop[bank] = hop;
+			else if(placement->next_hop[bank] != hop) placement->next_hop[bank] = HOP_MIXED;
+		}
+	}
+}
+
+static void fail_placement(struct BankPlacement *placement, enum PlacementFailure failure, int site){
+	if(placement->failure != PlacementFailure_NONE) return;
+	placement->failure = failure;
+	placement->failed_site = site;
+}
+
+// Places the blocks in order and sends every jump whose target ends up in a later bank through trampolines.
+// Trampolines and the instructions they need move everything after them, so this runs until nothing changes.
+// With allow_padding a fall-through chain that would run into the next bank starts there instead, the nops in
+// front of it follow a jmp or hlt so they are never executed.
+static void place_blocks(struct BasicBlock *blocks, int block_count, const int *order, int allow_padding, int has_scratch, struct BankPlacement *placement){
+	placement->failure = PlacementFailure_NONE;
+	placement->crossing_count = 0;
+	for(int b = 0; b < block_count; b++) placement->is_broken[b] = 0;
+	for(int site = 0; site < block_count * 2; site++) placement->uses_register[site] = 0;
+	memset(placement->is_gated, 0, sizeof(int) * placement->bank_capacity);
+
+	int changed = 1;
+	while(changed){
+		changed = 0;
+		int line = 0;
+		for(int i = 0; i < block_count; i++){
+			int b = order[i], size = get_placed_block_size(blocks, placement, b), start = line;
+			int is_fallen_into = i > 0 && blocks[order[i - 1]].fallthrough != -1 && !placement->is_broken[order[i - 1]];
+			if(allow_padding && i > 0 && !is_fallen_into){
+				int chain_size = 0;
+				for(int j = i; j < block_count && (j == i || (blocks[order[j - 1]].fallthrough != -1 && !placement->is_broken[order[j - 1]])); j++){
+					chain_size += get_placed_block_size(blocks, placement, order[j]);
+				}
+				if(line % BANK_SIZE + chain_size > BANK_SIZE && chain_size <= BANK_SIZE) start = (line / BANK_SIZE + 1) * BANK_SIZE;
+			}
+
+			// nothing may run into a pad, so a block over one moves past the dispatcher and falling into it becomes a jmp
+			int gate;
+			while(i > 0 && (gate = find_gate_in(placement, start, start + size)) != -1){
+				if(is_fallen_into){
+					placement->is_broken[order[i - 1]] = 1;
+					is_fallen_into = 0;
+					changed = 1;
+				}
+				start = (gate + 1) * BANK_SIZE + 1;
+			}
+			placement->new_start[b] = start;
+			line = start + size;
+		}
+		placement->line_count = line;
+
+		// every block starts at most one bank after the previous one ends, more banks mean placing would not settle
+		if(line / BANK_SIZE + 1 > 2 * block_count + 1){
+			fail_placement(placement, PlacementFailure_TOO_MANY_BANKS, 0);
+			return;
+		}
+		grow_bank_flags(placement, line / BANK_SIZE + 1);
+		for(int site = 0; site < block_count * 2; site++){
+			int target = get_site_target(blocks, placement, site);
+			if(target == -1) continue;
+			for(int bank = get_site_line(blocks, placement, site) / BANK_SIZE; bank < placement->new_start[target] / BANK_SIZE; bank++){
+				changed |= !placement->is_gated[bank];
+				placement->is_gated[bank] = 1;
+			}
+		}
+
+		find_next_hops(blocks, block_count, placement);
+		for(int site = 0; site < block_count * 2 && has_scratch; site++){
+			int target = get_site_target(blocks, placement, site);
+			if(target == -1 || placement->uses_register[site]) continue;
+			for(int bank = get_site_line(blocks, placement, site) / BANK_SIZE; bank < placement->new_start[target] / BANK_SIZE; bank++){
+				if(placement->next_hop[bank] == HOP_MIXED) placement->uses_register[site] = 1;
+			}
+			changed |= placement->uses_register[site];
+		}
+	}
+
+	if(find_gate_in(placement, 0, get_placed_block_size(blocks, placement, order[0])) != -1) fail_placement(placement, PlacementFailure_ENTRY_BLOCK, 0);
+	for(int site = 0; site < block_count * 2; site++){
+		int target = get_site_target(blocks, placement, site);
+		if(target == -1) continue;
+
+		int from = get_site_line(blocks, placement, site) / BANK_SIZE, to = placement->new_start[target] / BANK_SIZE;
+		if(to < from) fail_placement(placement, PlacementFailure_BACKWARD_JUMP, site);
+		if(to <= from) continue;
+
+		placement->crossing_count++;
+		int is_register_needed = 0;
+		for(int bank = from; bank < to; bank++){
+			if(placement->next_hop[bank] != HOP_MIXED) continue;
+			is_register_needed = 1;
+
+			// the register can either hold the target for the last dispatcher or send the earlier ones on, not both
+			if(bank < to - 1 && placement->next_hop[to - 1] == HOP_MIXED) fail_placement(placement, PlacementFailure_MIXED_DISPATCHER, bank);
+		}
+		if(is_register_needed && !has_scratch) fail_placement(placement, PlacementFailure_NO_SCRATCH_REGISTER, site);
+	}
+}
+
+// Writes the placed blocks with the nops, pads and dispatchers between them, every label moves with its block
+static void emit_placed_blocks(struct ParsingData *parsing_data, struct BasicBlock *blocks, int block_count, int *block_of, const int *order, int scratch, struct BankPlacement *placement, int *origins){
+	int count = parsing_data->instruction_count;
+	struct Instruction *instructions = (struct Instruction*) malloc(sizeof(struct Instruction) * placement->line_count);
+	int instruction_count = 0;
+
+	for(int i = 0; i < parsing_data->label_count; i++){
+		int line = parsing_data->goto_labels[i];
+		if(line == -1) continue;
+		parsing_data->goto_labels[i] = line >= count ? placement->line_count : placement->new_start[block_of[line]];
+	}
+
+	int *pad_labels = (int*) malloc(sizeof(int) * placement->bank_capacity);
+	for(int bank = 0; bank < placement->bank_capacity; bank++) pad_labels[bank] = -1;
+
+	for(int i = 0; i < block_count; i++){
+		int b = order[i];
+		while(instruction_count < placement->new_start[b]){
+			struct Instruction filler = { .opcode = 0, .flags = 0, .parameter_1 = 0, .parameter_2 = 0, .label = -1 };
+			int bank = instruction_count / BANK_SIZE - 1;
+			if(instruction_count % BANK_SIZE == 0 && bank >= 0 && placement->is_gated[bank] && placement->next_hop[bank] != HOP_UNUSED){
+				int hop = placement->next_hop[bank];
+				filler = (struct Instruction) { .opcode = OPCODE_JMP, .flags = 0b001, .parameter_1 = 0, .parameter_2 = 0, .label = -1 };
+				if(hop == HOP_MIXED){
+					filler.flags = 0b010;
+					filler.parameter_1 = scratch;
+				}else if(hop == HOP_NEXT_PAD){
+					if(pad_labels[bank + 1] == -1) pad_labels[bank + 1] = create_label(parsing_data, (bank + 1) * BANK_SIZE + BANK_SIZE - 1);
+					filler.label = pad_labels[bank + 1];
+				}else{
+					filler.label = create_label(parsing_data, placement->new_start[hop]);
+				}
+			}
+			if(origins != NULL) origins[instruction_count] = -1;
+			instructions[instruction_count++] = filler;
+		}
+
+		int body_end = blocks[b].target == -1 ? blocks[b].end : blocks[b].end - 1;
+		for(int j = blocks[b].start; j < body_end; j++){
+			if(origins != NULL) origins[instruction_count] = j;
+			instructions[instruction_count++] = parsing_data->instructions[j];
+		}
+
+		for(int site = 2 * b; site <= 2 * b + 1; site++){
+			int target = get_site_target(blocks, placement, site);
+			if(target == -1) continue;
+
+			struct Instruction jump = parsing_data->instructions[blocks[b].end - 1];
+			if(site % 2 == 1){
+				jump = (struct Instruction) { .opcode = OPCODE_JMP, .flags = 0b001, .parameter_1 = 0, .parameter_2 = 0, .label = create_label(parsing_data, placement->new_start[target]) };
+			}
+			if(placement->uses_register[site]){
+				int to = placement->new_start[target] / BANK_SIZE, is_last_dispatcher_shared = to > 0 && placement->next_hop[to - 1] == HOP_MIXED;
+				if(origins != NULL) origins[instruction_count] = -1;
+				instructions[instruction_count++] = (struct Instruction) {
+					.opcode = OPCODE_LOADIMM, .flags = 0b001, .parameter_1 = is_last_dispatcher_shared ? placement->new_start[target] % BANK_SIZE : BANK_SIZE - 1,
+					.parameter_2 = scratch, .label = -1
+				};
+			}
+
+			// a jump to a later bank goes to the pad at the end of its own bank
+			int bank = instruction_count / BANK_SIZE;
+			if(placement->new_start[target] / BANK_SIZE > bank){
+				if(pad_labels[bank] == -1) pad_labels[bank] = create_label(parsing_data, bank * BANK_SIZE + BANK_SIZE - 1);
+				jump.label = pad_labels[bank];
+			}
+			if(origins != NULL) origins[instruction_count] = site % 2 == 0 ? blocks[b].end - 1 : -1;
+			instructions[instruction_count++] = jump;
+		}
+	}
+
+	free(pad_labels);
+	free(parsing_data->instructions);
+	parsing_data->instructions = instructions;
+	parsing_data->instruction_count = instruction_count;
+	parsing_data->instruction_capacity = placement->line_count;
+}
+
+// Orders the fall-through chains so that chains jumping to each other share a bank.
+// Banks are filled one at a time, each time with the chain that has the most jumps to the chains already in the bank.
+static void order_chains_by_bank(struct ParsingData *parsing_data, struct BasicBlock *blocks, int block_count, int *order){
+	int *chain_of = (int*) malloc(sizeof(int) * block_count);
+	int chain_count = 0;
+	for(int b = 0; b < block_count; b++){
+		if(b == 0 || blocks[b - 1].fallthrough == -1) chain_count++;
+		chain_of[b] = chain_count - 1;
+	}
+
+	int *chain_first = (int*) malloc(sizeof(int) * chain_count);
+	int *chain_size = (int*) calloc(chain_count, sizeof(int));
+	int *chain_start = (int*) malloc(sizeof(int) * chain_count);
+	int *is_placed = (int*) calloc(chain_count, sizeof(int));
+	int *jumps_between = (int*) calloc((size_t) chain_count * chain_count, sizeof(int));
+	for(int b = block_count - 1; b >= 0; b--){
+		chain_first[chain_of[b]] = b;
+		chain_size[chain_of[b]] += blocks[b].end - blocks[b].start;
+		if(blocks[b].target != -1 && chain_of[blocks[b].target] != chain_of[b]){
+			jumps_between[chain_of[b] * chain_count + chain_of[blocks[b].target]]++;
+			jumps_between[chain_of[blocks[b].target] * chain_count + chain_of[b]]++;
+		}
+	}
+
+	// the entry chain stays first and a chain that runs off the end stays last
+	int last_chain = falls_off_end(parsing_data, blocks[block_count - 1]) && chain_of[block_count - 1] != 0 ? chain_of[block_count - 1] : -1;
+	int line = 0, order_length = 0;
+	for(int placed_count = 0; placed_count < chain_count; placed_count++){
+		int best = -1, best_score = -1, best_fits = 0;
+		int bank_start = line / BANK_SIZE * BANK_SIZE;
+		for(int c = 0; c < chain_count && placed_count > 0; c++){
+			if(is_placed[c] || c == last_chain) continue;
+
+			int score = 0, fits = line + chain_size[c] <= bank_start + BANK_SIZE;
+			for(int p = 0; p < chain_count; p++){
+				if(is_placed[p] && chain_start[p] + chain_size[p] > bank_start) score += jumps_between[c * chain_count + p];
+			}
+			if(score > best_score || (score == best_score && fits && !best_fits)){
+				best = c;
+				best_score = score;
+				best_fits = fits;
+			}
+		}
+		if(placed_count == 0) best = 0;
+		if(best == -1) best = last_chain;
+
+		// place_blocks may move a chain that does not fit in the rest of this bank to the start of the next one
+		if(placed_count > 0 && chain_size[best] <= BANK_SIZE && line % BANK_SIZE + chain_size[best] > BANK_SIZE) line = bank_start + BANK_SIZE;
+		is_placed[best] = 1;
+		chain_start[best] = line;
+		line += chain_size[best];
+		for(int b = chain_first[best]; b < block_count && chain_of[b] == best; b++) order[order_length++] = b;
+	}
+
+	free(jumps_between);
+	free(is_placed);
+	free(chain_start);
+	free(chain_size);
+	free(chain_first);
+	free(chain_of);
+}
+
+// Makes every jump land in the bank of its target. When one does not, the program is rearranged to keep jumps within
+// their bank and whatever still crosses goes through trampolines. An immediate jump target is an index into the first
+// bank, so those can only be used there. When origins is not NULL it receives the index every instruction of the
+// result had before placing, -1 for the ones placing added, and is released by the caller.
+static enum CompilerResult place_in_banks(struct ParsingData *parsing_data, int **origins){
+	int cross_bank_jump = find_cross_bank_jump(parsing_data);
+	int *placed_origins = NULL;
+	if(cross_bank_jump != -1){
+		struct BasicBlock *blocks;
+		int *block_of;
+		int block_count = find_basic_blocks(parsing_data, MAX_PLACED_BLOCK_LENGTH, &blocks, &block_of);
+		parsing_data->current_line = 0;
+
+		// resolve_labels has a better error for jumps to labels that are never defined
+		for(int i = 0; i < parsing_data->instruction_count && block_count == -1; i++){
+			if(parsing_data->instructions[i].label != -1 && parsing_data->goto_labels[parsing_data->instructions[i].label] == -1) goto placed;
+		}
+		if(block_count == -1){
+			report_error(parsing_data, "Instruction %d jumps from bank %d to bank %d and the program cannot be rearranged because not every jump goes to a label in it\n",
+				cross_bank_jump, cross_bank_jump / BANK_SIZE, parsing_data->goto_labels[parsing_data->instructions[cross_bank_jump].label] / BANK_SIZE);
+			return CompilerResult_CODE_GENERATION_ERROR;
+		}
+
+		int scratch = find_scratch_register(parsing_data);
+		struct BankPlacement placement = {
+			.new_start = (int*) malloc(sizeof(int) * block_count),
+			.is_broken = (int*) malloc(sizeof(int) * block_count),
+			.uses_register = (int*) malloc(sizeof(int) * block_count * 2),
+			.is_gated = (int*) calloc(BANK_COUNT, sizeof(int)),
+			.next_hop = (int*) malloc(sizeof(int) * BANK_COUNT),
+			.bank_capacity = BANK_COUNT
+		};
+		int *source_order = (int*) malloc(sizeof(int) * block_count);
+		int *bank_order = (int*) malloc(sizeof(int) * block_count);
+		for(int b = 0; b < block_count; b++) source_order[b] = b;
+
+		// a placement that works and fits in the ROM wins, then the one with the fewest trampolines, then the shortest.
+		// Ordering by bank is quadratic in the number of chains, so programs larger than the ROM keep their order.
+		const int *orders[] = { source_order, source_order, bank_order, bank_order };
+		int order_count = parsing_data->instruction_count <= BANK_SIZE * BANK_COUNT ? 4 : 2;
+		if(order_count == 4) order_chains_by_bank(parsing_data, blocks, block_count, bank_order);
+		int best = -1, best_score[4] = { 0 };
+		for(int i = 0; i < order_count; i++){
+			place_blocks(blocks, block_count, orders[i], i % 2, scratch != -1, &placement);
+			int score[4] = { placement.failure == PlacementFailure_NONE, placement.line_count <= BANK_SIZE * BANK_COUNT, -placement.crossing_count, -placement.line_count };
+			int is_better = best == -1, k = 0;
+			while(!is_better && k < 4 && score[k] == best_score[k]) k++;
+			if(is_better || (k < 4 && score[k] > best_score[k])){
+				best = i;
+				memcpy(best_score, score, sizeof(score));
+			}
+		}
+		place_blocks(blocks, block_count, orders[best], best % 2, scratch != -1, &placement);
+
+		enum PlacementFailure failure = placement.failure;
+		int site = placement.failed_site, from_line = 0, to_line = 0;
+		if(failure == PlacementFailure_BACKWARD_JUMP || failure == PlacementFailure_NO_SCRATCH_REGISTER){
+			from_line = get_site_line(blocks, &placement, site);
+			to_line = placement.new_start[get_site_target(blocks, &placement, site)];
+		}
+
+		if(failure == PlacementFailure_ENTRY_BLOCK){
+			report_error(parsing_data, "The first block is too long to leave room for the trampolines at the end of bank 0\n");
+		}else if(failure == PlacementFailure_BACKWARD_JUMP){
+			report_error(parsing_data, "The jump at instruction %d to instruction %d would go back from bank %d to bank %d, trampolines only lead forward\n",
+				from_line, to_line, from_line / BANK_SIZE, to_line / BANK_SIZE);
+		}else if(failure == PlacementFailure_MIXED_DISPATCHER){
+			report_error(parsing_data, "Jumps through the end of bank %d go to different places, and one of them goes on to another shared trampoline\n", site);
+		}else if(failure == PlacementFailure_NO_SCRATCH_REGISTER){
+			report_error(parsing_data, "The jump at instruction %d to instruction %d needs a trampoline through a register, but every general purpose register is used\n",
+				from_line, to_line);
+		}else if(failure == PlacementFailure_TOO_MANY_BANKS){
+			report_error(parsing_data, "The program could not be placed in banks, placing it kept moving blocks into later banks\n");
+		}else{
+			if(origins != NULL) placed_origins = (int*) malloc(sizeof(int) * placement.line_count);
+			emit_placed_blocks(parsing_data, blocks, block_count, block_of, orders[best], scratch, &placement, placed_origins);
+		}
+
+		free(bank_order);
+		free(source_order);
+		free(placement.next_hop);
+		free(placement.is_gated);
+		free(placement.uses_register);
+		free(placement.is_broken);
+		free(placement.new_start);
+		free(blocks);
+		free(block_of);
+		if(failure != PlacementFailure_NONE) return CompilerResult_CODE_GENERATION_ERROR;
+	}
+
+placed:
+	for(int i = BANK_SIZE; i < parsing_data->instruction_count; i++){
+		struct Instruction instruction = parsing_data->instructions[i];
+		if(is_jump(instruction) && instruction.flags == 0b001 && instruction.label == -1){
+			parsing_data->current_line = 0;
+			report_error(parsing_data, "The jump at instruction %d to the immediate target %d lands in bank %d, use a label to jump across banks\n",
+				i, instruction.parameter_1, i / BANK_SIZE);
+			free(placed_origins);
+			return CompilerResult_CODE_GENERATION_ERROR;
+		}
+	}
+
+	if(origins != NULL && placed_origins == NULL){
+		placed_origins = (int*) malloc(sizeof(int) * (parsing_data->instruction_count + 1));
+		for(int i = 0; i < parsing_data->instruction_count; i++) placed_origins[i] = i;
+	}
+	if(origins != NULL) *origins = placed_origins;
+	return CompilerResult_OK;
+}
+
+// Copy of the instructions and labels of the program for trying a pass on, it reports no errors
+static struct ParsingData copy_program(struct ParsingData *parsing_data){
+	struct ParsingData copy = *parsing_data;
+	copy.diag = NULL;
+	copy.instructions = (struct Instruction*) malloc(sizeof(struct Instruction) * parsing_data->instruction_capacity);
+	memcpy(copy.instructions, parsing_data->instructions, sizeof(struct Instruction) * parsing_data->instruction_count);
+	copy.goto_labels = (int*) malloc(sizeof(int) * parsing_data->label_capacity);
+	memcpy(copy.goto_labels, parsing_data->goto_labels, sizeof(int) * parsing_data->label_count);
+	return copy;
+}
+
+// Profile indices refer to the program as it is placed in banks without a profile. This places a copy of the program
+// to map them back to the instructions layout_blocks works on, edges to or from an instruction placing adds are dropped.
+static struct graphite_profile_edge *translate_profile(struct ParsingData *parsing_data, const struct graphite_profile_edge *profile, size_t profile_length, size_t *translated_length){
+	struct ParsingData placed = copy_program(parsing_data);
+	struct graphite_profile_edge *translated = (struct graphite_profile_edge*) malloc(sizeof(struct graphite_profile_edge) * (profile_length + 1));
+	*translated_length = 0;
+	int *origins = NULL;
+	if(place_in_banks(&placed, &origins) == CompilerResult_OK){
+		for(size_t i = 0; i < profile_length; i++){
+			if(profile[i].from >= placed.instruction_count || profile[i].to >= placed.instruction_count) continue;
+			int from = origins[profile[i].from], to = origins[profile[i].to];
+			if(from == -1 || to == -1) continue;
+			translated[(*translated_length)++] = (struct graphite_profile_edge) { .from = from, .to = to, .count = profile[i].count };
+		}
+	}
+
+	free(origins);
+	free(placed.goto_labels);
+	free(placed.instructions);
+	return translated;
+}
+
+// Chunks smaller than this are not worth a thread
+#define MIN_CHUNK_LENGTH (64 * 1024)
+
+// A piece of the source that ends right after a semicolon, lexed and parsed on its own thread.
+// Line numbers and label indices are local to the chunk until merge_chunks rebases them.
+struct SourceChunk{
+	const char *src;
+	size_t len;
+	struct SymbolTable *symbols;
+	struct ParsingData parsing_data;
+	struct graphite_diag diag;
+	enum CompilerResult result;
+	int line_count; // newlines in the chunk
+	pthread_t thread;
+};
+
+static void *parse_chunk(void *argument){
+	struct SourceChunk *chunk = (struct SourceChunk*) argument;
+	chunk->symbols = create_symbol_table();
+	struct Array *tokens = lexer(chunk->src, chunk->len, chunk->symbols);
+	chunk->diag.line = 0;
+	chunk->diag.message[0] = 0;
+
+	chunk->parsing_data = (struct ParsingData) {
+		.tokens = tokens,
+		.symbols = chunk->symbols,
+		.goto_labels = (int*) malloc(sizeof(int) * (chunk->symbols->label_count + 1)),
+		.label_count = chunk->symbols->label_count,
+		.label_capacity = chunk->symbols->label_count + 1,
+		.current_token_index = 0,
+		.current_line = 0,
+		.instructions = (struct Instruction*) malloc(sizeof(struct Instruction) * 64),
+		.instruction_count = 0,
+		.instruction_capacity = 64,
+		.diag = &chunk->diag,
+		.label_definitions = CreateArray()
+	};
+	memset(chunk->parsing_data.goto_labels, -1, sizeof(int) * (chunk->symbols->label_count + 1));
+	chunk->result = parse(&chunk->parsing_data);
+
+	// the tokens are only needed while parsing
+	for(int i = 0; i < tokens->length; i++){
+		struct Token token = GET_ELEMENT_FROM_ARRAY(tokens, struct Token, i);
+		if(token.type == TokenType_ERROR) free(token.value.string);
+	}
+	chunk->line_count = (GET_ELEMENT_FROM_ARRAY(tokens, struct Token, tokens->length - 1)).line - 1;
+	chunk->parsing_data.tokens = NULL;
+	FreeArray(tokens);
+	return NULL;
+}
+
+// Concatenates the chunks into parsing_data the way parsing the whole source at once would have produced them.
+// Labels are numbered in the order they first appear in the source and errors are reported in source order,
+// so everything after this does not know the source was split.
+static enum CompilerResult merge_chunks(struct SourceChunk *chunks, int chunk_count, struct ParsingData *parsing_data){
+	struct SymbolTable *symbols = parsing_data->symbols;
+	int **label_maps = (int**) malloc(sizeof(int*) * chunk_count);
+	for(int c = 0; c < chunk_count; c++){
+		struct SymbolTable *chunk_symbols = chunks[c].symbols;
+		label_maps[c] = (int*) malloc(sizeof(int) * (chunk_symbols->label_count + 1));
+
+		// labels are added to a symbol table in the order they are first seen
+		for(int i = 0; i < chunk_symbols->symbol_count; i++){
+			struct Symbol symbol = chunk_symbols->symbols[i];
+			if(SYMBOL_KIND(symbol.id) != SymbolKind_LABEL) continue;
+			label_maps[c][SYMBOL_INDEX(symbol.id)] = SYMBOL_INDEX(intern_symbol(symbols, symbol.name, symbol.length));
+		}
+	}
+
+	parsing_data->label_count = symbols->label_count;
+	parsing_data->label_capacity = symbols->label_count + 1;
+	parsing_data->goto_labels = (int*) malloc(sizeof(int) * parsing_data->label_capacity);
+	memset(parsing_data->goto_labels, -1, sizeof(int) * parsing_data->label_capacity);
+
+	enum CompilerResult result = CompilerResult_OK;
+	int line_offset = 0;
+	for(int c = 0; c < chunk_count && result == CompilerResult_OK; c++){
+		struct ParsingData *chunk_data = &chunks[c].parsing_data;
+		int base = parsing_data->instruction_count;
+
+		// a chunk stops at its first error, so the labels it defined all come before that error
+		for(int i = 0; i < chunk_data->label_definitions->length && result == CompilerResult_OK; i++){
+			struct LabelDefinition definition = GET_ELEMENT_FROM_ARRAY(chunk_data->label_definitions, struct LabelDefinition, i);
+			int label = label_maps[c][definition.label];
+			if(parsing_data->goto_labels[label] != -1){
+				parsing_data->current_line = definition.line + line_offset;
+				report_error(parsing_data, "Goto label %s is defined more than once\n", get_symbol_name(symbols, SYMBOL_ID(SymbolKind_LABEL, label)));
+				result = CompilerResult_PARSING_ERROR;
+			}else{
+				parsing_data->goto_labels[label] = base + chunk_data->goto_labels[definition.label];
+			}
+		}
+
+		if(result == CompilerResult_OK && chunks[c].result != CompilerResult_OK){
+			if(parsing_data->diag != NULL){
+				*parsing_data->diag = chunks[c].diag;
+				parsing_data->diag->line += line_offset;
+			}
+			result = chunks[c].result;
+		}
+
+		for(int i = 0; i < chunk_data->instruction_count && result == CompilerResult_OK; i++){
+			struct Instruction instruction = chunk_data->instructions[i];
+			if(instruction.label != -1) instruction.label = label_maps[c][instruction.label];
+			instruction.source_line += line_offset;
+			if(parsing_data->instruction_count == parsing_data->instruction_capacity){
+				parsing_data->instruction_capacity *= 2;
+				parsing_data->instructions = (struct Instruction*) realloc(parsing_data->instructions, sizeof(struct Instruction) * parsing_data->instruction_capacity);
+			}
+			parsing_data->instructions[parsing_data->instruction_count++] = instruction;
+		}
+		line_offset += chunks[c].line_count;
+	}
+
+	for(int c = 0; c < chunk_count; c++) free(label_maps[c]);
+	free(label_maps);
+	return result;
+}
+
+// Splits the source after semicolons into up to thread_count chunks and parses them concurrently
+static enum CompilerResult parse_in_chunks(const char *src, size_t len, int thread_count, struct ParsingData *parsing_data){
+	// the lexer stops at a NUL, so the chunks after one must not be parsed
+	const char *nul = (const char*) memchr(src, 0, len);
+	if(nul != NULL) len = nul - src;
+
+	int chunk_count = len / MIN_CHUNK_LENGTH < thread_count ? len / MIN_CHUNK_LENGTH : thread_count;
+	if(chunk_count < 1) chunk_count = 1;
+
+	struct SourceChunk *chunks = (struct SourceChunk*) malloc(sizeof(struct SourceChunk) * chunk_count);
+	size_t start = 0;
+	int used_chunks = 0;
+	for(int c = 0; c < chunk_count && start < len; c++){
+		size_t end = len;
+		if(c + 1 < chunk_count){
+			// nothing in the language spans a semicolon, so every chunk can be lexed on its own
+			const char *semicolon = (const char*) memchr(src + len * (c + 1) / chunk_count, ';', len - len * (c + 1) / chunk_count);
+			if(semicolon != NULL && (size_t) (semicolon - src) >= start) end = semicolon - src + 1;
+		}
+		chunks[used_chunks].src = src + start;
+		chunks[used_chunks].len = end - start;
+		used_chunks++;
+		start = end;
+	}
+
+	// a chunk whose thread cannot be started is parsed on this one instead
+	int *is_started = (int*) calloc(used_chunks + 1, sizeof(int));
+	for(int c = 1; c < used_chunks; c++) is_started[c] = pthread_create(&chunks[c].thread, NULL, parse_chunk, &chunks[c]) == 0;
+	for(int c = 0; c < used_chunks; c++){
+		if(!is_started[c]) parse_chunk(&chunks[c]);
+	}
+	for(int c = 1; c < used_chunks; c++){
+		if(is_started[c]) pthread_join(chunks[c].thread, NULL);
+	}
+	free(is_started);
+
+	enum CompilerResult result = merge_chunks(chunks, used_chunks, parsing_data);
+
+	for(int c = 0; c < used_chunks; c++){
+		free(chunks[c].parsing_data.instructions);
+		free(chunks[c].parsing_data.goto_labels);
+		FreeArray(chunks[c].parsing_data.label_definitions);
+		free_symbol_table(chunks[c].symbols);
+	}
+	free(chunks);
+	return result;
+}
+
+long graphite_assemble(const char *src, size_t len, uint32_t *out, size_t cap, struct graphite_diag *d){
+	return graphite_assemble_with_options(src, len, out, cap, NULL, d);
+}
+
+long graphite_assemble_with_options(const char *src, size_t len, uint32_t *out, size_t cap, const struct graphite_options *options, struct graphite_diag *d){
+	if(d != NULL){
+		d->line = 0;
+		d->message[0] = 0;
+	}
+
+	struct SymbolTable *symbols = create_symbol_table();
+	struct ParsingData parsing_data = {
+		.tokens = NULL,
+		.symbols = symbols,
+		.goto_labels = NULL,
+		.label_count = 0,
+		.label_capacity = 0,
+		.current_token_index = 0,
+		.current_line = 0,
+		.instructions = (struct Instruction*) malloc(sizeof(struct Instruction) * 64),
+		.instruction_count = 0,
+		.instruction_capacity = 64,
+		.diag = d,
+		.label_definitions = NULL
+	};
+
+	long result = -1;
+	enum CompilerResult parse_result;
+	if(options != NULL && options->thread_count > 1){
+		parse_result = parse_in_chunks(src, len, options->thread_count, &parsing_data);
+	}else{
+		parsing_data.tokens = lexer(src, len, symbols);
+		parsing_data.goto_labels = (int*) malloc(sizeof(int) * (symbols->label_count + 1));
+		parsing_data.label_count = symbols->label_count;
+		parsing_data.label_capacity = symbols->label_count + 1;
+		memset(parsing_data.goto_labels, -1, sizeof(int) * (symbols->label_count + 1));
+		parse_result = parse(&parsing_data);
+	}
+
+	if(parse_result == CompilerResult_OK && options != NULL && options->remove_dead_alu){
+		remove_dead_alu(&parsing_data);
+	}
+
+	if(parse_result == CompilerResult_OK && options != NULL && options->compact){
+		compact_code(&parsing_data, options->stats);
+	}
+
+	if(parse_result == CompilerResult_OK && options != NULL && options->profile_length > 0){
+		size_t profile_length;
+		struct graphite_profile_edge *profile = translate_profile(&parsing_data, options->profile, options->profile_length, &profile_length);
+		struct ParsingData unprofiled = copy_program(&parsing_data);
+		layout_blocks(&parsing_data, profile, profile_length);
+
+		// the layout does not know about banks, so it is dropped when the program cannot be placed with it
+		struct ParsingData placed = copy_program(&parsing_data);
+		if(place_in_banks(&placed, NULL) != CompilerResult_OK){
+			free(parsing_data.instructions);
+			free(parsing_data.goto_labels);
+			unprofiled.diag = parsing_data.diag;
+			parsing_data = unprofiled;
+		}else{
+			free(unprofiled.instructions);
+			free(unprofiled.goto_labels);
+		}
+
+		free(placed.instructions);
+		free(placed.goto_labels);
+		free(profile);
+	}
+
+	if(parse_result == CompilerResult_OK) parse_result = place_in_banks(&parsing_data, NULL);
+
+	if(parse_result == CompilerResult_OK && resolve_labels(&parsing_data) == CompilerResult_OK){
+		for(int i = 0; i < parsing_data.instruction_count && i < cap; i++){
+			out[i] = encode_instruction(parsing_data.instructions[i]);
+		}
+		result = parsing_data.instruction_count;
+	}
+
+	// the passes after parsing all explain their errors, this only guards the promise made in the header
+	if(result == -1){
+		parsing_data.current_line = 0;
+		report_error(&parsing_data, "Was not able to assemble the program\n");
+	}
+
+	for(int i = 0; parsing_data.tokens != NULL && i < parsing_data.tokens->length; i++){
+		struct Token token = GET_ELEMENT_FROM_ARRAY(parsing_data.tokens, struct Token, i);
+		if(token.type == TokenType_ERROR) free(token.value.string);
+	}
+
+	free(parsing_data.instructions);
+	free(parsing_data.goto_labels);
+	if(parsing_data.tokens != NULL) FreeArray(parsing_data.tokens);
+	free_symbol_table(symbols);
+	return result;
+}
@@ -0,0 +1,83 @@
+#ifndef GRAPHITEASM_H
+#define GRAPHITEASM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Instructions are encoded into the low 24 bits of a word, from the most significant bit:
+// opcode (5) flags (3) parameter_1 (8) parameter_2 (8)
+#define GRAPHITE_INSTRUCTION_BITS 24
+#define GRAPHITE_OPCODE(word) (((word) >> 19) & 0b11111)
+#define GRAPHITE_FLAGS(word) (((word) >> 16) & 0b111)
+#define GRAPHITE_PARAMETER_1(word) (((word) >> 8) & 0xff)
+#define GRAPHITE_PARAMETER_2(word) ((word) & 0xff)
+
+// The ROM holds 4 banks of 256 instructions and execution runs from one bank into the next, but a jump only encodes the
+// low 8 bits of its target and lands in its own bank. Programs are rearranged so jumps stay within their bank. A jump
+// that still crosses goes to a nop on the last slot of its bank, which runs into a jmp on the first slot of the next
+// one. When several jumps share that jmp it goes through a register the program never names, which they load with
+// their target first. A run of instructions too long to fit between two trampolines is cut into pieces, joined by a
+// jmp where a trampoline comes between them. Jumps back to an earlier bank and immediate jump targets outside the
+// first bank are errors.
+// Programs larger than the ROM are still assembled so tools can work on them, the banks past the fourth do not exist
+// on the machine. The assembler warns about them and generate_schematic.py rejects them.
+#define GRAPHITE_ROM_SIZE (4 * 256)
+
+struct graphite_diag{
+	int line; // source line of the first error, 0 when it is not tied to a line
+	char message[256];
+};
+
+// One edge of an execution profile: execution continued from instruction `from` at instruction `to` `count` times.
+// Indices refer to the image assembled with the same options but without a profile.
+struct graphite_profile_edge{
+	uint32_t from;
+	uint32_t to;
+	uint64_t count;
+};
+
+// Filled by an assembly that has compact set
+struct graphite_stats{
+	size_t tail_merge_saved; // instructions saved by replacing duplicate tails with a jmp to one copy
+	size_t outline_saved; // instructions saved by moving repeated runs into subroutines
+};
+
+struct graphite_options{
+	// when set, basic blocks are reordered so the hottest successors become fall-throughs
+	const struct graphite_profile_edge *profile;
+	size_t profile_length;
+
+	// when set, ALU instructions whose accumulator and flags are set again by a later one before anything reads them
+	// are removed. An ALU result only depends on the operands and no register is written, so a run of ALU
+	// instructions is equivalent to its last one and no shorter sequence than that exists.
+	int remove_dead_alu;
+
+	// when set, identical code is shared to make the program smaller. Repeated runs are only outlined when one of
+	// the general purpose registers is never used, it holds the return address. Outlined programs return through
+	// a register so the profile layout leaves them alone.
+	int compact;
+	struct graphite_stats *stats; // may be NULL
+
+	// when above 1, the source is split at semicolons and the pieces are lexed and parsed on up to this many threads.
+	// The result is the same as with a single thread.
+	int thread_count;
+};
+
+// Assembles len bytes of src into out.
+// Returns the number of instructions in the program, only the first cap of them are written so a
+// caller can retry with a larger buffer when the result exceeds cap. Returns -1 on error and fills d
+// when it is not NULL. Nothing is printed and no memory is handed to the caller.
+long graphite_assemble(const char *src, size_t len, uint32_t *out, size_t cap, struct graphite_diag *d);
+
+// Same as graphite_assemble, options may be NULL. The options and everything they point to stay owned by the caller.
+long graphite_assemble_with_options(const char *src, size_t len, uint32_t *out, size_t cap, const struct graphite_options *options, struct graphite_diag *d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+import ctypes
+import os
+
+# ctypes binding for libgraphiteasm.so, build it with `make libgraphiteasm.so`
+
+class Diag(ctypes.Structure):
+    _fields_ = [("line", ctypes.c_int), ("message", ctypes.c_char * 256)]
+
+class AssemblyError(Exception):
+    def __init__(self, line, message):
+        super().__init__(f"line {line}: {message}")
+        self.line = line
+        self.message = message
+
+_library = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), "libgraphiteasm.so"))
+_library.graphite_assemble.argtypes = [
+    ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_uint32), ctypes.c_size_t, ctypes.POINTER(Diag)
+]
+_library.graphite_assemble.restype = ctypes.c_long
+
+def assemble(source):
+    # returns the encoded instructions as a list of 24 bit integers
+    encoded_source = source.encode() if isinstance(source, str) else source
+    capacity = 1024
+    while True:
+        instructions = (ctypes.c_uint32 * capacity)()
+        diag = Diag()
+        instruction_count = _library.graphite_assemble(encoded_source, len(encoded_source), instructions, capacity, ctypes.byref(diag))
+        if instruction_count < 0:
+            raise AssemblyError(diag.line, diag.message.decode())
+        if instruction_count <= capacity:
+            return list(instructions[:instruction_count])
+        capacity = instruction_count
+
+def format_instruction(instruction):
+    # same layout as the assembler's text output: opcode flags parameter_1 parameter_2
+    bits = f"{instruction:024b}"
+    return f"{bits[0:5]} {bits[5:8]} {bits[8:16]} {bits[16:24]}"
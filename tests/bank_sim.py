@@ -0,0 +1,151 @@
+import random
+import subprocess
+import sys
+
+# Checks that placing programs in ROM banks keeps what they do. A small part of the language is run straight from the
+# source and compared with running the assembled image the way the ROM does: a jump only replaces the low 8 bits of
+# the program counter, so it stays in its bank, and execution runs from the end of one bank into the next.
+#
+#   python3 tests/bank_sim.py ./assembler tests/*.asm       every file has to assemble and behave the same
+#   python3 tests/bank_sim.py ./assembler --random 1 300    random programs, errors from the assembler are allowed
+#
+# Sources may use labels, add/sub/xor/and/or with a register and an immediate, mov, nop, jmp, cjmp and hlt.
+# Whether a cjmp is taken follows a fixed sequence per condition, so both runs take the same branches.
+
+BANK_SIZE = 256
+STEP_LIMIT = 20000
+TIMEOUT = 20
+ALU_OPCODES = {"add": 0b00001, "sub": 0b00010, "xor": 0b00011, "and": 0b00100, "or": 0b00101}
+REGISTERS = {"ax": 1, "bx": 2, "cx": 3, "dx": 4, "ex": 5, "fx": 6, "gx": 7}
+OPCODE_LOADIMM = 0b10010
+OPCODE_JMP = 0b11101
+OPCODE_CJMP = 0b11110
+OPCODE_HLT = 0b11111
+
+def is_taken(condition, times_seen):
+    return ((condition * 2654435761 + times_seen * 40503) >> 7) & 1
+
+def run_source(source):
+    # returns every ALU instruction executed as (opcode, register, immediate) and whether the program came to an end
+    statements = []
+    labels = {}
+    for statement in source.split(";"):
+        statement = statement.strip()
+        while ":" in statement:
+            label, statement = statement.split(":", 1)
+            labels[label.strip()] = len(statements)
+            statement = statement.strip()
+        if statement:
+            statements.append(statement.split())
+
+    trace, times_seen, line = [], {}, 0
+    for _ in range(STEP_LIMIT):
+        if line >= len(statements) or statements[line][0] == "hlt":
+            return trace, True
+        mnemonic, operands = statements[line][0], statements[line][1:]
+        line += 1
+        if mnemonic == "jmp":
+            line = labels[operands[0]]
+        elif mnemonic == "cjmp":
+            condition = int(operands[1])
+            if is_taken(condition, times_seen.get(condition, 0)):
+                line = labels[operands[0]]
+            times_seen[condition] = times_seen.get(condition, 0) + 1
+        elif mnemonic in ALU_OPCODES:
+            trace.append((ALU_OPCODES[mnemonic], REGISTERS[operands[0]], int(operands[1])))
+    return trace, False
+
+def run_image(image):
+    # trampolines add instructions on the way, so the image gets more steps
+    trace, times_seen, registers, line = [], {}, [0] * 8, 0
+    for _ in range(STEP_LIMIT * 4):
+        if line >= len(image) or image[line][0] == OPCODE_HLT:
+            return trace, True
+        opcode, flags, parameter_1, parameter_2 = image[line]
+        bank = line // BANK_SIZE
+        line += 1
+        if opcode == OPCODE_JMP:
+            line = bank * BANK_SIZE + (registers[parameter_1] if flags == 0b010 else parameter_1)
+        elif opcode == OPCODE_CJMP:
+            if is_taken(parameter_2, times_seen.get(parameter_2, 0)):
+                line = bank * BANK_SIZE + parameter_1
+            times_seen[parameter_2] = times_seen.get(parameter_2, 0) + 1
+        elif opcode == OPCODE_LOADIMM and flags == 0b001:
+            registers[parameter_2] = parameter_1
+        elif opcode in ALU_OPCODES.values():
+            trace.append((opcode, parameter_1, parameter_2))
+    return trace, False
+
+def assemble(assembler, path):
+    # returns the image or the assembler's message
+    try:
+        result = subprocess.run([assembler, path], capture_output=True, text=True, timeout=TIMEOUT)
+    except subprocess.TimeoutExpired:
+        return None, f"did not finish in {TIMEOUT}s"
+    if result.returncode != 0:
+        return None, result.stdout.strip() + result.stderr.strip()
+    return [tuple(int(field, 2) for field in line.split()) for line in result.stdout.splitlines()], None
+
+def check(assembler, path, allow_errors):
+    # returns a description of what went wrong or None
+    image, message = assemble(assembler, path)
+    if image is None:
+        is_crash = "did not finish" in message or message == "" or "Sanitizer" in message or "runtime error" in message
+        return None if allow_errors and not is_crash else message
+
+    expected, is_source_finished = run_source(open(path, "r").read())
+    actual, is_image_finished = run_image(image)
+    length = min(len(expected), len(actual))
+    # a run cut off by the step limit only has to agree with the other one as far as it got
+    if expected[:length] != actual[:length] or (is_source_finished and len(expected) < len(actual)) or (is_image_finished and len(actual) < len(expected)):
+        same = next((i for i in range(length) if expected[i] != actual[i]), length)
+        return f"the image does something else than the source after {same} ALU instructions"
+    return None
+
+def generate(rng, path):
+    # blocks of ALU instructions ending in jumps to random labels, some of them long enough to fill a bank
+    block_count = rng.randint(2, 40)
+    forward_bias = rng.choice([0.6, 0.9, 1.0])
+    blocks, condition = [], 0
+    for block in range(block_count):
+        body = [f"add {rng.choice(['ax', 'bx', 'cx'])} {rng.randint(0, 255)}" for _ in range(rng.randint(1, rng.choice([3, 10, 40, 120, 300])))]
+        ending = ""
+        is_forward = rng.random() < forward_bias
+        target = rng.randint(block + 1, block_count - 1) if is_forward and block + 1 < block_count else rng.randint(0, block)
+        kind = rng.random()
+        if block == block_count - 1:
+            ending = " hlt;"
+        elif kind < 0.4:
+            condition += 1
+            ending = f" cjmp L{target} {condition};"
+        elif kind < 0.6:
+            ending = f" jmp L{target};"
+        blocks.append(f"L{block}: " + "; ".join(body) + ";" + ending)
+    open(path, "w").write("\n".join(blocks) + "\n")
+
+arguments = sys.argv[1:]
+if len(arguments) < 2:
+    print("Expected the assembler and either input files or --random seed count")
+    sys.exit(2)
+
+failures = []
+if arguments[1] == "--random":
+    rng = random.Random(int(arguments[2]))
+    for index in range(int(arguments[3])):
+        path = "bank_sim_random.asm"
+        generate(rng, path)
+        failure = check(arguments[0], path, True)
+        if failure is not None:
+            failed_path = f"bank_sim_failure_{index}.asm"
+            open(failed_path, "w").write(open(path, "r").read())
+            failures.append((failed_path, failure))
+else:
+    for path in arguments[1:]:
+        failure = check(arguments[0], path, False)
+        if failure is not None:
+            failures.append((path, failure))
+
+for path, failure in failures:
+    print(f"{path}: {failure}")
+print(f"{len(failures)} failure(s)")
+sys.exit(1 if failures else 0)
@@ -0,0 +1,503 @@
+cjmp far 2;
+add ax 0;
+add ax 1;
+add ax 2;
+add ax 3;
+add ax 4;
+add ax 5;
+add ax 6;
+add ax 7;
+add ax 8;
+add ax 9;
+add ax 10;
+add ax 11;
+add ax 12;
+add ax 13;
+add ax 14;
+add ax 15;
+add ax 16;
+add ax 17;
+add ax 18;
+add ax 19;
+add ax 20;
+add ax 21;
+add ax 22;
+add ax 23;
+add ax 24;
+add ax 25;
+add ax 26;
+add ax 27;
+add ax 28;
+add ax 29;
+add ax 30;
+add ax 31;
+add ax 32;
+add ax 33;
+add ax 34;
+add ax 35;
+add ax 36;
+add ax 37;
+add ax 38;
+add ax 39;
+add ax 40;
+add ax 41;
+add ax 42;
+add ax 43;
+add ax 44;
+add ax 45;
+add ax 46;
+add ax 47;
+add ax 48;
+add ax 49;
+add ax 50;
+add ax 51;
+add ax 52;
+add ax 53;
+add ax 54;
+add ax 55;
+add ax 56;
+add ax 57;
+add ax 58;
+add ax 59;
+add ax 60;
+add ax 61;
+add ax 62;
+add ax 63;
+add ax 64;
+add ax 65;
+add ax 66;
+add ax 67;
+add ax 68;
+add ax 69;
+add ax 70;
+add ax 71;
+add ax 72;
+add ax 73;
+add ax 74;
+add ax 75;
+add ax 76;
+add ax 77;
+add ax 78;
+add ax 79;
+add ax 80;
+add ax 81;
+add ax 82;
+add ax 83;
+add ax 84;
+add ax 85;
+add ax 86;
+add ax 87;
+add ax 88;
+add ax 89;
+add ax 90;
+add ax 91;
+add ax 92;
+add ax 93;
+add ax 94;
+add ax 95;
+add ax 96;
+add ax 97;
+add ax 98;
+add ax 99;
+add ax 100;
+add ax 101;
+add ax 102;
+add ax 103;
+add ax 104;
+add ax 105;
+add ax 106;
+add ax 107;
+add ax 108;
+add ax 109;
+add ax 110;
+add ax 111;
+add ax 112;
+add ax 113;
+add ax 114;
+add ax 115;
+add ax 116;
+add ax 117;
+add ax 118;
+add ax 119;
+add ax 120;
+add ax 121;
+add ax 122;
+add ax 123;
+add ax 124;
+add ax 125;
+add ax 126;
+add ax 127;
+add ax 128;
+add ax 129;
+add ax 130;
+add ax 131;
+add ax 132;
+add ax 133;
+add ax 134;
+add ax 135;
+add ax 136;
+add ax 137;
+add ax 138;
+add ax 139;
+add ax 140;
+add ax 141;
+add ax 142;
+add ax 143;
+add ax 144;
+add ax 145;
+add ax 146;
+add ax 147;
+add ax 148;
+add ax 149;
+add ax 150;
+add ax 151;
+add ax 152;
+add ax 153;
+add ax 154;
+add ax 155;
+add ax 156;
+add ax 157;
+add ax 158;
+add ax 159;
+add ax 160;
+add ax 161;
+add ax 162;
+add ax 163;
+add ax 164;
+add ax 165;
+add ax 166;
+add ax 167;
+add ax 168;
+add ax 169;
+add ax 170;
+add ax 171;
+add ax 172;
+add ax 173;
+add ax 174;
+add ax 175;
+add ax 176;
+add ax 177;
+add ax 178;
+add ax 179;
+add ax 180;
+add ax 181;
+add ax 182;
+add ax 183;
+add ax 184;
+add ax 185;
+add ax 186;
+add ax 187;
+add ax 188;
+add ax 189;
+add ax 190;
+add ax 191;
+add ax 192;
+add ax 193;
+add ax 194;
+add ax 195;
+add ax 196;
+add ax 197;
+add ax 198;
+add ax 199;
+add ax 200;
+add ax 201;
+add ax 202;
+add ax 203;
+add ax 204;
+add ax 205;
+add ax 206;
+add ax 207;
+add ax 208;
+add ax 209;
+add ax 210;
+add ax 211;
+add ax 212;
+add ax 213;
+add ax 214;
+add ax 215;
+add ax 216;
+add ax 217;
+add ax 218;
+add ax 219;
+add ax 220;
+add ax 221;
+add ax 222;
+add ax 223;
+add ax 224;
+add ax 225;
+add ax 226;
+add ax 227;
+add ax 228;
+add ax 229;
+add ax 230;
+add ax 231;
+add ax 232;
+add ax 233;
+add ax 234;
+add ax 235;
+add ax 236;
+add ax 237;
+add ax 238;
+add ax 239;
+add ax 240;
+add ax 241;
+add ax 242;
+add ax 243;
+add ax 244;
+add ax 245;
+add ax 246;
+add ax 247;
+add ax 248;
+add ax 249;
+add ax 250;
+add ax 251;
+add ax 252;
+add ax 253;
+add ax 254;
+add ax 255;
+add ax 0;
+add ax 1;
+add ax 2;
+add ax 3;
+add ax 4;
+add ax 5;
+add ax 6;
+add ax 7;
+add ax 8;
+add ax 9;
+add ax 10;
+add ax 11;
+add ax 12;
+add ax 13;
+add ax 14;
+add ax 15;
+add ax 16;
+add ax 17;
+add ax 18;
+add ax 19;
+add ax 20;
+add ax 21;
+add ax 22;
+add ax 23;
+add ax 24;
+add ax 25;
+add ax 26;
+add ax 27;
+add ax 28;
+add ax 29;
+add ax 30;
+add ax 31;
+add ax 32;
+add ax 33;
+add ax 34;
+add ax 35;
+add ax 36;
+add ax 37;
+add ax 38;
+add ax 39;
+add ax 40;
+add ax 41;
+add ax 42;
+add ax 43;
+add ax 44;
+add ax 45;
+add ax 46;
+add ax 47;
+add ax 48;
+add ax 49;
+add ax 50;
+add ax 51;
+add ax 52;
+add ax 53;
+add ax 54;
+add ax 55;
+add ax 56;
+add ax 57;
+add ax 58;
+add ax 59;
+add ax 60;
+add ax 61;
+add ax 62;
+add ax 63;
+add ax 64;
+add ax 65;
+add ax 66;
+add ax 67;
+add ax 68;
+add ax 69;
+add ax 70;
+add ax 71;
+add ax 72;
+add ax 73;
+add ax 74;
+add ax 75;
+add ax 76;
+add ax 77;
+add ax 78;
+add ax 79;
+add ax 80;
+add ax 81;
+add ax 82;
+add ax 83;
+add ax 84;
+add ax 85;
+add ax 86;
+add ax 87;
+add ax 88;
+add ax 89;
+add ax 90;
+add ax 91;
+add ax 92;
+add ax 93;
+add ax 94;
+add ax 95;
+add ax 96;
+add ax 97;
+add ax 98;
+add ax 99;
+add ax 100;
+add ax 101;
+add ax 102;
+add ax 103;
+add ax 104;
+add ax 105;
+add ax 106;
+add ax 107;
+add ax 108;
+add ax 109;
+add ax 110;
+add ax 111;
+add ax 112;
+add ax 113;
+add ax 114;
+add ax 115;
+add ax 116;
+add ax 117;
+add ax 118;
+add ax 119;
+add ax 120;
+add ax 121;
+add ax 122;
+add ax 123;
+add ax 124;
+add ax 125;
+add ax 126;
+add ax 127;
+add ax 128;
+add ax 129;
+add ax 130;
+add ax 131;
+add ax 132;
+add ax 133;
+add ax 134;
+add ax 135;
+add ax 136;
+add ax 137;
+add ax 138;
+add ax 139;
+add ax 140;
+add ax 141;
+add ax 142;
+add ax 143;
+add ax 144;
+add ax 145;
+add ax 146;
+add ax 147;
+add ax 148;
+add ax 149;
+add ax 150;
+add ax 151;
+add ax 152;
+add ax 153;
+add ax 154;
+add ax 155;
+add ax 156;
+add ax 157;
+add ax 158;
+add ax 159;
+add ax 160;
+add ax 161;
+add ax 162;
+add ax 163;
+add ax 164;
+add ax 165;
+add ax 166;
+add ax 167;
+add ax 168;
+add ax 169;
+add ax 170;
+add ax 171;
+add ax 172;
+add ax 173;
+add ax 174;
+add ax 175;
+add ax 176;
+add ax 177;
+add ax 178;
+add ax 179;
+add ax 180;
+add ax 181;
+add ax 182;
+add ax 183;
+add ax 184;
+add ax 185;
+add ax 186;
+add ax 187;
+add ax 188;
+add ax 189;
+add ax 190;
+add ax 191;
+add ax 192;
+add ax 193;
+add ax 194;
+add ax 195;
+add ax 196;
+add ax 197;
+add ax 198;
+add ax 199;
+add ax 200;
+add ax 201;
+add ax 202;
+add ax 203;
+add ax 204;
+add ax 205;
+add ax 206;
+add ax 207;
+add ax 208;
+add ax 209;
+add ax 210;
+add ax 211;
+add ax 212;
+add ax 213;
+add ax 214;
+add ax 215;
+add ax 216;
+add ax 217;
+add ax 218;
+add ax 219;
+add ax 220;
+add ax 221;
+add ax 222;
+add ax 223;
+add ax 224;
+add ax 225;
+add ax 226;
+add ax 227;
+add ax 228;
+add ax 229;
+add ax 230;
+add ax 231;
+add ax 232;
+add ax 233;
+add ax 234;
+add ax 235;
+add ax 236;
+add ax 237;
+add ax 238;
+add ax 239;
+add ax 240;
+add ax 241;
+add ax 242;
+add ax 243;
+far: add bx 1;
+hlt;
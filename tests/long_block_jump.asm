@@ -0,0 +1,262 @@
+jmp far;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+far: hlt;
@@ -0,0 +1,257 @@
+jmp far;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+mov ax bx;
+jmp far;
+far: hlt;